@@ -0,0 +1,136 @@
+/*
+ * Arena allocator on huge pages. See arena.h.
+ */
+
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+static size_t round_up(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Map capacity bytes starting at a multiple of ARENA_HUGE_PAGE. mmap() only promises page
+// alignment, so map one huge page more than needed and unmap the unaligned ends.
+static char* map_aligned(size_t capacity) {
+    size_t length = capacity + ARENA_HUGE_PAGE;
+    char* mapping = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+
+    char* base = (char*)round_up((uintptr_t)mapping, ARENA_HUGE_PAGE);
+    if (base > mapping) {
+        munmap(mapping, base - mapping);
+    }
+    size_t tail = (mapping + length) - (base + capacity);
+    if (tail > 0) {
+        munmap(base + capacity, tail);
+    }
+    return base;
+}
+
+int arena_init(arena* a, size_t capacity, arena_pages pages) {
+    a->capacity = round_up(capacity > 0 ? capacity : 1, ARENA_HUGE_PAGE);
+    a->used = 0;
+    a->base = NULL;
+    a->pages = pages;
+
+    if (pages == ARENA_EXPLICIT_HUGE) {
+        // Huge page mappings are always aligned to the huge page size.
+        void* base = mmap(NULL, a->capacity, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base != MAP_FAILED) {
+            a->base = base;
+            return 0;
+        }
+        // Usually ENOMEM: no (or not enough) huge pages reserved in /proc/sys/vm/nr_hugepages.
+        a->pages = ARENA_TRANSPARENT_HUGE;
+    }
+
+    a->base = map_aligned(a->capacity);
+    if (a->base == NULL) {
+        return -1;
+    }
+
+    // Only a hint: the kernel may still use either page size. The call fails (harmlessly) on
+    // kernels without transparent huge pages.
+    madvise(a->base, a->capacity,
+            a->pages == ARENA_TRANSPARENT_HUGE ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+    return 0;
+}
+
+void arena_destroy(arena* a) {
+    if (a->base != NULL) {
+        munmap(a->base, a->capacity);
+    }
+    a->base = NULL;
+    a->capacity = 0;
+    a->used = 0;
+}
+
+void* arena_alloc(arena* a, size_t size, size_t alignment) {
+    if (alignment < ARENA_ALIGN) {
+        alignment = ARENA_ALIGN;
+    }
+
+    // Align the address rather than the offset, so that alignments above ARENA_HUGE_PAGE work too.
+    size_t start = round_up((uintptr_t)a->base + a->used, alignment) - (uintptr_t)a->base;
+    if (start > a->capacity || size > a->capacity - start) {
+        return NULL;
+    }
+
+    a->used = start + size;
+    return a->base + start;
+}
+
+void arena_reset(arena* a) {
+    a->used = 0;
+}
+
+const char* arena_pages_name(arena_pages pages) {
+    switch (pages) {
+    case ARENA_SMALL_PAGES:
+        return "small";
+    case ARENA_TRANSPARENT_HUGE:
+        return "transparent_huge";
+    case ARENA_EXPLICIT_HUGE:
+        return "explicit_huge";
+    }
+    return "unknown";
+}
+
+size_t arena_huge_bytes(const void* address) {
+    FILE* smaps = fopen("/proc/self/smaps", "r");
+    if (smaps == NULL) {
+        return 0;
+    }
+
+    // Every mapping starts with a line "start-end perms ..." followed by lines "Name: value kB".
+    // Sum the huge page lines of the mapping that contains address.
+    uintptr_t target = (uintptr_t)address;
+    int inside = 0;
+    size_t bytes = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), smaps) != NULL) {
+        unsigned long start, end, kib;
+        char name[64];
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            if (inside) {
+                break; // the next mapping
+            }
+            inside = start <= target && target < end;
+        } else if (inside && sscanf(line, "%63s %lu kB", name, &kib) == 2) {
+            if (strcmp(name, "AnonHugePages:") == 0 || strcmp(name, "Private_Hugetlb:") == 0
+                || strcmp(name, "Shared_Hugetlb:") == 0) {
+                bytes += kib * 1024;
+            }
+        }
+    }
+
+    fclose(smaps);
+    return bytes;
+}
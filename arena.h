@@ -0,0 +1,83 @@
+/*
+ * An arena for the large working arrays: aligned memory, backed by huge pages where possible.
+ *
+ * malloc() of a large array returns memory made of 4 KiB pages, aligned only to 16 bytes. For an
+ * array of several GiB that costs in two ways:
+ *
+ *      TLB misses -- the processor caches address translations in the TLB, which holds a few
+ *                    thousand entries. With 4 KiB pages they cover a few MiB, so a pass over a
+ *                    large array misses the TLB on every new page, and a scattered access pattern
+ *                    misses on nearly every access. A 2 MiB huge page needs one entry for 512 times
+ *                    as much memory.
+ *      Alignment  -- a vectorized loop over data that does not start on a vector (or cache line)
+ *                    boundary runs a scalar "peel" loop first, and more of its loads cross cache
+ *                    lines.
+ *
+ * An arena maps one large region with mmap() and hands out pieces of it, each aligned to at least
+ * ARENA_ALIGN bytes. There is no per-allocation free: arena_reset() makes the whole region
+ * available again while keeping it mapped, so a program that runs the same computation many times
+ * (like a benchmark) faults the pages in only once. The pages can be:
+ *
+ *      ARENA_SMALL_PAGES      -- ordinary 4 KiB pages (MADV_NOHUGEPAGE), for comparison
+ *      ARENA_TRANSPARENT_HUGE -- transparent huge pages: the region is aligned to ARENA_HUGE_PAGE
+ *                                and marked with madvise(MADV_HUGEPAGE), and the kernel uses 2 MiB
+ *                                pages when it can (/sys/kernel/mm/transparent_hugepage/enabled
+ *                                must be "always" or "madvise")
+ *      ARENA_EXPLICIT_HUGE    -- pages from the reserved huge page pool (mmap with MAP_HUGETLB),
+ *                                which must be set up first, e.g.
+ *                                echo 1024 > /proc/sys/vm/nr_hugepages
+ *
+ * If explicit huge pages are not available, arena_init() falls back to transparent huge pages;
+ * arena->pages says what the arena actually got. Either way the pages are only allocated when they
+ * are first written, so first touch (see placement.h) still decides their NUMA node.
+ *
+ *      arena a;
+ *      arena_init(&a, bytes, ARENA_TRANSPARENT_HUGE);
+ *      for (each run) {
+ *          unsigned long* array = arena_alloc(&a, n * sizeof(unsigned long), ARENA_ALIGN);
+ *          ...
+ *          arena_reset(&a);
+ *      }
+ *      arena_destroy(&a);
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_ALIGN 64              // default alignment: a cache line, a full AVX-512 vector
+#define ARENA_HUGE_PAGE (2UL << 20) // 2 MiB, the huge page size on x86-64 and most arm64
+
+typedef enum { ARENA_SMALL_PAGES, ARENA_TRANSPARENT_HUGE, ARENA_EXPLICIT_HUGE } arena_pages;
+
+typedef struct {
+    char* base;      // start of the region, aligned to ARENA_HUGE_PAGE
+    size_t capacity; // bytes in the region, a multiple of ARENA_HUGE_PAGE
+    size_t used;     // bytes handed out since the last arena_reset()
+    arena_pages pages;
+} arena;
+
+// Map a region of at least capacity bytes with the requested pages. Returns 0 on success and -1
+// (with errno set) if no memory could be mapped.
+int arena_init(arena* a, size_t capacity, arena_pages pages);
+
+// Unmap the region. Everything allocated from the arena becomes invalid.
+void arena_destroy(arena* a);
+
+// size bytes aligned to alignment (a power of 2; smaller values are raised to ARENA_ALIGN), or
+// NULL if the arena is full.
+void* arena_alloc(arena* a, size_t size, size_t alignment);
+
+// Make the whole arena available again. The pages stay mapped (and keep their contents).
+void arena_reset(arena* a);
+
+// "small", "transparent_huge" or "explicit_huge".
+const char* arena_pages_name(arena_pages pages);
+
+// Bytes of the mapping containing address that are backed by huge pages (transparent or explicit),
+// from /proc/self/smaps. Works for any address, including memory from malloc(). Returns 0 if the
+// mapping is not found.
+size_t arena_huge_bytes(const void* address);
+
+#endif
@@ -0,0 +1,259 @@
+/*
+ * Benchmark of the arena allocator (arena.h): malloc() vs an arena on small pages, on transparent
+ * huge pages and on explicit (hugetlbfs) huge pages.
+ *
+ * For every allocator, array size and thread count the program allocates an array of unsigned
+ * long, fills it in parallel (first touch, like bug_hunt_solution.c) and runs two passes over it:
+ *
+ *      stream -- the statistics pass of bug_hunt_solution.c (stats.h): sequential, so the hardware
+ *                prefetcher hides most of the memory latency, and a TLB miss happens once per page
+ *      random -- the same number of reads at scattered positions: nearly every read is on a
+ *                different page, so with 4 KiB pages nearly every read also misses the TLB
+ *
+ * Each pass is timed with bench_measure() and then run once more with hardware counters (see
+ * perf_counters.h) to count the dTLB misses. Where counters are not available the columns say
+ * "n/a". The other columns show what the allocator returned: "align" is the largest power of 2
+ * (up to 4096) that divides the address, and "huge_mib" the part of the array's mapping that the
+ * kernel backed with huge pages.
+ *
+ * malloc() gets a new array for every run. Each arena is created once per allocator and reset
+ * between runs, so only its first run pays for the page faults: compare fill_s of the first and
+ * later rows.
+ *
+ * Compile:
+ *  make arena_bench
+ * Run:     ./arena_bench [--threads LIST] [--sizes LIST] [--warmup N] [--trials N]
+ * Example: ./arena_bench --threads 1,8 --sizes 16777216,268435456 > arena.csv
+ */
+
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "bench.h"
+#include "perf_counters.h"
+#include "stats.h"
+
+#define ALLOCATOR_MALLOC -1 // in place of an arena_pages value
+
+static const struct {
+    const char* name;
+    int pages; // arena_pages, or ALLOCATOR_MALLOC
+} allocators[] = {
+    { "malloc", ALLOCATOR_MALLOC },
+    { "arena_small", ARENA_SMALL_PAGES },
+    { "arena_transparent", ARENA_TRANSPARENT_HUGE },
+    { "arena_explicit", ARENA_EXPLICIT_HUGE },
+};
+
+static const unsigned int num_allocators = sizeof(allocators) / sizeof(allocators[0]);
+
+typedef enum { KERNEL_STREAM, KERNEL_RANDOM } kernel_type;
+
+static const char* const kernel_names[] = { "stream", "random" };
+
+typedef struct {
+    kernel_type type;
+    const unsigned long* data;
+    unsigned long n;
+    unsigned int thread_count;
+    perf_region* region; // counters around each thread's share, or NULL
+    unsigned long result;
+} kernel_run;
+
+static void run_kernel(void* arg) {
+    kernel_run* run = arg;
+    const unsigned long* data = run->data;
+    unsigned long n = run->n;
+    unsigned long num_blocks = (n + STATS_BLOCK - 1) / STATS_BLOCK;
+    stats total;
+    stats_init(&total);
+    unsigned long sum = 0;
+
+#pragma omp parallel num_threads(run->thread_count) reduction(stats_merge : total) \
+    reduction(+ : sum)
+    {
+        perf_thread_state state;
+        if (run->region != NULL) {
+            perf_thread_begin(run->region, &state);
+        }
+
+        if (run->type == KERNEL_STREAM) {
+#pragma omp for schedule(static) nowait
+            for (unsigned long b = 0; b < num_blocks; b++) {
+                unsigned long start = b * STATS_BLOCK;
+                unsigned long count = n - start < STATS_BLOCK ? n - start : STATS_BLOCK;
+                stats_add_block(&total, data + start, count);
+            }
+        } else {
+            // Multiplying by a large odd constant scatters consecutive i over the whole array.
+#pragma omp for schedule(static) nowait
+            for (unsigned long i = 0; i < n; i++) {
+                sum += data[(i * 2654435761UL) % n];
+            }
+        }
+
+        if (run->region != NULL) {
+            perf_thread_end(run->region, &state);
+        }
+    }
+
+    run->result = run->type == KERNEL_STREAM ? total.max : sum;
+}
+
+// Values 1 .. n, written in parallel with the blocks of the stream pass (first touch).
+static void fill(unsigned long* array, unsigned long n, unsigned int thread_count) {
+    unsigned long num_blocks = (n + STATS_BLOCK - 1) / STATS_BLOCK;
+
+#pragma omp parallel for num_threads(thread_count) schedule(static)
+    for (unsigned long b = 0; b < num_blocks; b++) {
+        unsigned long end = (b + 1) * STATS_BLOCK < n ? (b + 1) * STATS_BLOCK : n;
+        for (unsigned long i = b * STATS_BLOCK; i < end; i++) {
+            array[i] = i + 1;
+        }
+    }
+}
+
+// Largest power of 2 dividing the address, at most 4096.
+static unsigned long alignment_of(const void* address) {
+    uintptr_t value = (uintptr_t)address | 4096;
+    return value & -value;
+}
+
+// Time both passes over the array and print one row per pass. Returns 0 if the results are right.
+static int run_passes(const char* allocator, const char* pages, unsigned long* array,
+                      unsigned long n, unsigned int thread_count, const bench_config* config) {
+    double start = omp_get_wtime();
+    fill(array, n, thread_count);
+    double fill_seconds = omp_get_wtime() - start;
+    double huge_mib = arena_huge_bytes(array) / (1024.0 * 1024.0);
+    double mib = n * sizeof(unsigned long) / (1024.0 * 1024.0);
+
+    for (int k = KERNEL_STREAM; k <= KERNEL_RANDOM; k++) {
+        kernel_run run = { .type = k, .data = array, .n = n, .thread_count = thread_count };
+        bench_result result;
+        bench_measure(config, run_kernel, &run, &result);
+
+        perf_region region;
+        perf_region_init(&region, thread_count);
+        run.region = &region;
+        run_kernel(&run);
+        perf_thread_counts counts;
+        perf_region_total(&region, &counts);
+        perf_region_free(&region);
+
+        printf("%s,%s,%u,%lu,%lu,%.1f,%.6f,%s,%.9f,%.9f,%.9f,%.1f,", allocator, pages,
+               thread_count, n, alignment_of(array), huge_mib, fill_seconds, kernel_names[k],
+               result.min, result.median, result.p95, mib / result.median);
+        if (counts.used && counts.valid[PERF_DTLB_MISSES] && counts.valid[PERF_INSTRUCTIONS]
+            && counts.values[PERF_INSTRUCTIONS] > 0) {
+            printf("%lu,%.3f\n", counts.values[PERF_DTLB_MISSES],
+                   1000.0 * counts.values[PERF_DTLB_MISSES] / counts.values[PERF_INSTRUCTIONS]);
+        } else {
+            printf("n/a,n/a\n");
+        }
+        fflush(stdout);
+
+        // The maximum of 1 .. n is n. The random pass reads n values of at least 1.
+        if ((k == KERNEL_STREAM && run.result != n) || (k == KERNEL_RANDOM && run.result == 0)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--threads LIST] [--sizes LIST] [--warmup N] [--trials N]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads[BENCH_MAX_LIST];
+    unsigned long sizes[BENCH_MAX_LIST] = { 1UL << 24, 1UL << 26 }; // 128 MiB, 512 MiB
+    int num_threads = bench_default_threads(threads, BENCH_MAX_LIST);
+    int num_sizes = 2;
+    bench_config config = { .warmup = 1, .trials = 5 };
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(argv[i], "--threads") == 0) {
+            num_threads = bench_parse_list(argv[++i], threads, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--sizes") == 0) {
+            num_sizes = bench_parse_list(argv[++i], sizes, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--warmup") == 0) {
+            config.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--trials") == 0) {
+            config.trials = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (num_threads < 0 || num_sizes < 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    unsigned long max_size = 0;
+    for (int s = 0; s < num_sizes; s++) {
+        max_size = sizes[s] > max_size ? sizes[s] : max_size;
+    }
+
+    printf("allocator,pages,threads,size,align,huge_mib,fill_s,kernel,min_s,median_s,p95_s,"
+           "mib_per_s,dtlb_misses,dtlb_mpki\n");
+
+    for (unsigned int a = 0; a < num_allocators; a++) {
+        // One arena per allocator, large enough for the largest array and reused for all runs.
+        arena arena;
+        const char* pages = "small";
+        if (allocators[a].pages != ALLOCATOR_MALLOC) {
+            if (arena_init(&arena, max_size * sizeof(unsigned long), allocators[a].pages) != 0) {
+                perror("arena_init");
+                return EXIT_FAILURE;
+            }
+            pages = arena_pages_name(arena.pages);
+        }
+
+        for (int s = 0; s < num_sizes; s++) {
+            for (int t = 0; t < num_threads; t++) {
+                unsigned long n = sizes[s];
+                unsigned long* array;
+                if (allocators[a].pages == ALLOCATOR_MALLOC) {
+                    array = malloc(n * sizeof(unsigned long));
+                } else {
+                    arena_reset(&arena);
+                    array = arena_alloc(&arena, n * sizeof(unsigned long), ARENA_ALIGN);
+                }
+                if (array == NULL) {
+                    fprintf(stderr, "Cannot allocate %lu numbers\n", n);
+                    return EXIT_FAILURE;
+                }
+
+                int status = run_passes(allocators[a].name, pages, array, n, threads[t], &config);
+                if (allocators[a].pages == ALLOCATOR_MALLOC) {
+                    free(array);
+                }
+                if (status != 0) {
+                    fprintf(stderr, "Incorrect result for %s, %lu threads\n", allocators[a].name,
+                            threads[t]);
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+
+        if (allocators[a].pages != ALLOCATOR_MALLOC) {
+            arena_destroy(&arena);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+/*
+ * Online schedule autotuner. See autotune.h.
+ */
+
+#include "autotune.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "schedule.h"
+
+#define DEFAULT_CACHE_PATH "omp_tune.cache"
+#define LINE_LENGTH 256
+
+// The (kind, chunk size) pairs that are tried. Chunk size 0 means the default for the kind.
+static const autotune_candidate default_candidates[] = {
+    { omp_sched_static, 0 },     { omp_sched_static, 16 },   { omp_sched_static, 256 },
+    { omp_sched_dynamic, 1 },    { omp_sched_dynamic, 16 },  { omp_sched_dynamic, 256 },
+    { omp_sched_dynamic, 4096 }, { omp_sched_guided, 0 },    { omp_sched_guided, 64 },
+};
+
+static const char* cache_path(void) {
+    const char* path = getenv("OMP_TUNE_CACHE");
+    return path != NULL ? path : DEFAULT_CACHE_PATH;
+}
+
+static unsigned int log2_bucket(unsigned long n) {
+    unsigned int bucket = 0;
+    while (n > 1) {
+        n >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+// Return 1 if the cache line is for this loop's key, and parse its schedule into *candidate.
+static int parse_line(const autotune_loop* loop, const char* line, autotune_candidate* candidate) {
+    char id[AUTOTUNE_ID_LENGTH];
+    char schedule[32];
+    unsigned int bucket, threads;
+    double seconds;
+
+    if (sscanf(line, "%63s %u %u %31s %lf", id, &bucket, &threads, schedule, &seconds) != 5) {
+        return 0;
+    }
+    if (strcmp(id, loop->loop_id) != 0 || bucket != loop->trip_bucket || threads != loop->threads) {
+        return 0;
+    }
+    return schedule_parse(schedule, &candidate->kind, &candidate->chunk_size) == 0;
+}
+
+static int cache_lookup(const autotune_loop* loop, autotune_candidate* candidate) {
+    FILE* file = fopen(cache_path(), "r");
+    if (file == NULL) {
+        return 0;
+    }
+
+    char line[LINE_LENGTH];
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), file) != NULL) {
+        found = parse_line(loop, line, candidate);
+    }
+
+    fclose(file);
+    return found;
+}
+
+// Rewrite the cache with this loop's entry replaced (or added). Writing to a temporary file and
+// renaming it means a reader never sees a half-written cache.
+static void cache_store(const autotune_loop* loop, autotune_candidate best, double seconds) {
+    const char* path = cache_path();
+    char temp_path[LINE_LENGTH];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+
+    FILE* out = fopen(temp_path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "autotune: cannot write %s\n", temp_path);
+        return;
+    }
+
+    FILE* in = fopen(path, "r");
+    if (in != NULL) {
+        char line[LINE_LENGTH];
+        autotune_candidate ignored;
+        while (fgets(line, sizeof(line), in) != NULL) {
+            if (!parse_line(loop, line, &ignored)) {
+                fputs(line, out);
+            }
+        }
+        fclose(in);
+    }
+
+    char schedule[32];
+    schedule_format(best.kind, best.chunk_size, schedule, sizeof(schedule));
+    fprintf(out, "%s %u %u %s %.9f\n", loop->loop_id, loop->trip_bucket, loop->threads, schedule,
+            seconds);
+    fclose(out);
+
+    if (rename(temp_path, path) != 0) {
+        fprintf(stderr, "autotune: cannot replace %s\n", path);
+    }
+}
+
+void autotune_init(autotune_loop* loop, const char* loop_id, unsigned long trip_count,
+                   unsigned int threads) {
+    memset(loop, 0, sizeof(*loop));
+    snprintf(loop->loop_id, sizeof(loop->loop_id), "%s", loop_id);
+    loop->trip_bucket = log2_bucket(trip_count);
+    loop->threads = threads;
+
+    loop->num_candidates = sizeof(default_candidates) / sizeof(default_candidates[0]);
+    for (unsigned int c = 0; c < loop->num_candidates; c++) {
+        loop->candidates[c] = default_candidates[c];
+        loop->best_time[c] = -1.0;
+    }
+
+    // A cached result becomes the only candidate, and the loop starts tuned.
+    autotune_candidate cached;
+    if (cache_lookup(loop, &cached)) {
+        loop->candidates[0] = cached;
+        loop->num_candidates = 1;
+        loop->tuned = 1;
+        loop->from_cache = 1;
+    }
+}
+
+void autotune_begin(autotune_loop* loop) {
+    autotune_candidate candidate = autotune_current(loop);
+    omp_set_schedule(candidate.kind, candidate.chunk_size);
+}
+
+void autotune_end(autotune_loop* loop, double seconds) {
+    if (loop->tuned) {
+        return;
+    }
+
+    unsigned int c = loop->current;
+    if (loop->best_time[c] < 0.0 || seconds < loop->best_time[c]) {
+        loop->best_time[c] = seconds;
+    }
+
+    loop->measured++;
+    loop->current = loop->measured / AUTOTUNE_REPEATS;
+    if (loop->current < loop->num_candidates) {
+        return;
+    }
+
+    // Every candidate has been measured: keep the fastest.
+    unsigned int best = 0;
+    for (c = 1; c < loop->num_candidates; c++) {
+        if (loop->best_time[c] < loop->best_time[best]) {
+            best = c;
+        }
+    }
+
+    loop->current = best;
+    loop->tuned = 1;
+    cache_store(loop, loop->candidates[best], loop->best_time[best]);
+}
+
+autotune_candidate autotune_current(const autotune_loop* loop) {
+    return loop->candidates[loop->current];
+}
@@ -0,0 +1,75 @@
+/*
+ * Online autotuner for the schedule kind and chunk size of a recurring parallel loop.
+ *
+ * As scheduling.c explains, the best schedule depends on the loop, the machine and the number of
+ * threads, and finding it "may require experimentation". The autotuner does that experimentation
+ * for us while the program runs. The loop must use schedule(runtime), and each invocation of the
+ * loop is wrapped like this:
+ *
+ *      autotune_loop tuner;
+ *      autotune_init(&tuner, "my_loop", trip_count, thread_count);
+ *      ...
+ *      autotune_begin(&tuner);                 // calls omp_set_schedule() with a candidate
+ *      double start = omp_get_wtime();
+ *      #pragma omp parallel for schedule(runtime) ...
+ *      ...
+ *      autotune_end(&tuner, omp_get_wtime() - start);
+ *
+ * During the first invocations every candidate (kind, chunk size) pair is timed AUTOTUNE_REPEATS
+ * times. After that, the fastest candidate (by its best time) is used for all later invocations
+ * and saved to a tuning cache file. The cache is keyed by (loop id, trip count bucket, thread
+ * count), where the bucket is floor(log2(trip count)), so the next run of the program starts on
+ * the tuned schedule without searching again.
+ *
+ * The cache is a text file with one line per key:
+ *      <loop_id> <trip_bucket> <threads> <schedule> <seconds>
+ * where <schedule> is written like OMP_SCHEDULE, e.g. "dynamic,16".
+ * Its path is taken from the OMP_TUNE_CACHE environment variable, or "omp_tune.cache" in the
+ * current directory.
+ */
+
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <omp.h>
+
+#define AUTOTUNE_MAX_CANDIDATES 16
+#define AUTOTUNE_REPEATS 2
+#define AUTOTUNE_ID_LENGTH 64
+
+typedef struct {
+    omp_sched_t kind;
+    int chunk_size;
+} autotune_candidate;
+
+typedef struct {
+    char loop_id[AUTOTUNE_ID_LENGTH];
+    unsigned int trip_bucket;
+    unsigned int threads;
+
+    unsigned int num_candidates;
+    autotune_candidate candidates[AUTOTUNE_MAX_CANDIDATES];
+    double best_time[AUTOTUNE_MAX_CANDIDATES]; // best time seen for each candidate
+
+    unsigned int current;  // candidate used by the current invocation
+    unsigned int measured; // number of timed invocations so far
+    int tuned;             // 1 once the search is finished (or the cache had an entry)
+    int from_cache;        // 1 if the tuned schedule was loaded from the cache
+} autotune_loop;
+
+// Set up tuning for one loop. Looks up the cache; if there is an entry for this key, the loop
+// starts tuned. loop_id must not contain whitespace.
+void autotune_init(autotune_loop* loop, const char* loop_id, unsigned long trip_count,
+                   unsigned int threads);
+
+// Select the schedule for the next invocation with omp_set_schedule().
+void autotune_begin(autotune_loop* loop);
+
+// Report the wall time of the invocation started by autotune_begin(). When the last candidate
+// has been measured, the fastest is chosen and written to the cache.
+void autotune_end(autotune_loop* loop, double seconds);
+
+// The schedule the loop will use next (the best one once tuned).
+autotune_candidate autotune_current(const autotune_loop* loop);
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * Benchmark harness. See bench.h.
+ */
+
+#include "bench.h"
+
+#include <errno.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+void bench_summarize(double* times, unsigned int count, bench_result* result) {
+    qsort(times, count, sizeof(double), compare_double);
+
+    result->min = times[0];
+    if (count % 2 == 1) {
+        result->median = times[count / 2];
+    } else {
+        result->median = (times[count / 2 - 1] + times[count / 2]) / 2.0;
+    }
+
+    // Nearest-rank percentile: the smallest value that is >= 95% of the samples.
+    unsigned int rank = (95 * count + 99) / 100;
+    result->p95 = times[rank - 1];
+}
+
+void bench_measure(const bench_config* config, bench_kernel kernel, void* arg,
+                   bench_result* result) {
+    for (unsigned int i = 0; i < config->warmup; i++) {
+        kernel(arg);
+    }
+
+    unsigned int trials = config->trials > 0 ? config->trials : 1;
+    double* times = malloc(trials * sizeof(double));
+
+    for (unsigned int i = 0; i < trials; i++) {
+        double start = omp_get_wtime();
+        kernel(arg);
+        times[i] = omp_get_wtime() - start;
+    }
+
+    bench_summarize(times, trials, result);
+    free(times);
+}
+
+void bench_csv_header(FILE* out) {
+    fprintf(out, "kernel,threads,size,min_s,median_s,p95_s,speedup,efficiency\n");
+}
+
+void bench_csv_row(FILE* out, const char* kernel, unsigned int threads, unsigned long size,
+                   const bench_result* result, double serial_seconds) {
+    double speedup = serial_seconds / result->median;
+    double efficiency = speedup / threads;
+
+    fprintf(out, "%s,%u,%lu,%.9f,%.9f,%.9f,%.3f,%.3f\n", kernel, threads, size, result->min,
+            result->median, result->p95, speedup, efficiency);
+    fflush(out);
+}
+
+int bench_parse_list(const char* text, unsigned long* values, int max_values,
+                     unsigned long min_value) {
+    int count = 0;
+    const char* p = text;
+
+    while (*p != '\0') {
+        char* end;
+        errno = 0;
+        unsigned long value = strtoul(p, &end, 10);
+        if (end == p || errno != 0 || value < min_value || count == max_values) {
+            return -1;
+        }
+        values[count++] = value;
+
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0') {
+            return -1;
+        }
+        p = end;
+    }
+
+    return count > 0 ? count : -1;
+}
+
+int bench_default_threads(unsigned long* values, int max_values) {
+    unsigned long procs = omp_get_num_procs();
+    int count = 0;
+
+    for (unsigned long t = 1; t < procs && count < max_values - 1; t *= 2) {
+        values[count++] = t;
+    }
+    values[count++] = procs;
+
+    return count;
+}
+
+int bench_run_self(char* const* args, int num_env, const char* const* names,
+                   const char* const* values) {
+    // Output buffered in this process must not be printed twice or after the child's output.
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < num_env; i++) {
+            setenv(names[i], values[i], 1);
+        }
+        execv("/proc/self/exe", args);
+        perror("execv");
+        _exit(EXIT_FAILURE);
+    }
+
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != EXIT_SUCCESS) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * Small benchmark harness shared by the benchmark programs.
+ *
+ * Timing uses omp_get_wtime(), which returns wall-clock time in seconds as a double. A kernel is
+ * first run a few times without timing (warm-up: page faults, thread team creation, caches), then
+ * run "trials" times with timing. We report the minimum, median and 95th percentile of the trial
+ * times. The minimum is the least noisy, the median is the typical run, and the p95 shows how bad
+ * the slow runs get.
+ *
+ * Results are printed as CSV (one row per kernel/thread count/size) so that runs on different
+ * machines or different commits can be compared with a spreadsheet or a script.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+
+#define BENCH_MAX_LIST 64
+
+typedef struct {
+    unsigned int warmup; // untimed runs before measuring
+    unsigned int trials; // timed runs
+} bench_config;
+
+typedef struct {
+    double min;
+    double median;
+    double p95;
+} bench_result;
+
+// A kernel to be timed. "arg" is passed through unchanged.
+typedef void (*bench_kernel)(void* arg);
+
+// Run kernel(arg) config->warmup times untimed and config->trials times timed.
+void bench_measure(const bench_config* config, bench_kernel kernel, void* arg,
+                   bench_result* result);
+
+// Summarize "count" timings (in seconds) into min/median/p95. The array is sorted in place.
+void bench_summarize(double* times, unsigned int count, bench_result* result);
+
+// Print the CSV header line matching bench_csv_row().
+void bench_csv_header(FILE* out);
+
+// Print one CSV row. serial_seconds is the median time of the same kernel and size on 1 thread;
+// speedup = serial_seconds / median and efficiency = speedup / threads.
+void bench_csv_row(FILE* out, const char* kernel, unsigned int threads, unsigned long size,
+                   const bench_result* result, double serial_seconds);
+
+// Parse a comma-separated list of integers like "1,2,4,8", each at least min_value. Returns the
+// number of values stored in "values" (at most max_values), or -1 if the text is not a valid list.
+int bench_parse_list(const char* text, unsigned long* values, int max_values,
+                     unsigned long min_value);
+
+// Run this program again (/proc/self/exe) with the argument vector args (NULL-terminated) and
+// the environment variables names[i]=values[i] added, and wait for it to finish. Used for settings
+// the OpenMP runtime reads only when it starts, like OMP_WAIT_POLICY or OMP_PROC_BIND. Returns 0 if
+// the program exited successfully, -1 otherwise.
+int bench_run_self(char* const* args, int num_env, const char* const* names,
+                   const char* const* values);
+
+// Fill "values" with 1, 2, 4, ... up to the number of available processors (the processor count
+// itself is always included). Returns the number of values stored.
+int bench_default_threads(unsigned long* values, int max_values);
+
+#endif
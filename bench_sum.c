@@ -0,0 +1,239 @@
+/*
+ * Benchmark of the sum programs (scope.c, reduction.c, parallel_for.c and scheduling.c).
+ *
+ * The tutorial programs only tell us whether the result is correct. This program times the same
+ * kernels (see sum_kernels.h) so we can compare critical vs reduction vs parallel for vs different
+ * schedules on our own hardware. Every kernel is run for every combination of thread count and
+ * upper_bound, with warm-up runs and repeated trials (see bench.h), and the results are printed as
+ * CSV on stdout.
+ *
+ * The task kernels (taskloop_grain and tasks) are also run for every value of --cutoffs: the
+ * grainsize of the taskloop, or the range size below which the recursive version stops creating
+ * tasks. The kernel column shows it, e.g. "tasks_16384". Compare them with parallel_for to find
+ * the cutoff at which the task overhead stops mattering (and the size below which tasks lose).
+ *
+ * The "wide" kernel sums into 128 bits without overflow (wide_sum.h); compare it with
+ * parallel_for to see what the overflow safety costs per number.
+ *
+ * Speedup and efficiency are relative to the same kernel and upper_bound on 1 thread. If 1 is not
+ * in the thread list, the 1-thread time is still measured but not printed.
+ *
+ * Compile:
+ *  make bench_sum
+ * Run:     ./bench_sum [--threads LIST] [--sizes LIST] [--kernels LIST] [--cutoffs LIST]
+ *                     [--warmup N] [--trials N]
+ * Example: ./bench_sum --threads 1,2,4 --sizes 1000000,100000000 --trials 5 > results.csv
+ *          ./bench_sum --kernels parallel_for,tasks --cutoffs 256,4096,65536 > tasks.csv
+ * OR
+ *  make bench
+ */
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "sum_kernels.h"
+#include "wide_sum.h"
+
+typedef enum {
+    KERNEL_CRITICAL,
+    KERNEL_REDUCTION,
+    KERNEL_PARALLEL_FOR,
+    KERNEL_SCHEDULE,
+    KERNEL_TASKLOOP,
+    KERNEL_TASKLOOP_GRAIN,
+    KERNEL_TASKS,
+    KERNEL_WIDE,
+} kernel_type;
+
+typedef struct {
+    const char* name;
+    kernel_type type;
+    omp_sched_t kind; // only used by the schedule kernels
+    int chunk_size;   // schedule kernels: chunk size; taskloop: number of tasks per thread
+    int uses_cutoff;  // 1 if the kernel is run once for every value of --cutoffs
+} kernel_info;
+
+static const kernel_info kernels[] = {
+    { "critical", KERNEL_CRITICAL, 0, 0, 0 },
+    { "reduction", KERNEL_REDUCTION, 0, 0, 0 },
+    { "parallel_for", KERNEL_PARALLEL_FOR, 0, 0, 0 },
+    { "static_2", KERNEL_SCHEDULE, omp_sched_static, 2, 0 }, // the schedule used in scheduling.c
+    { "static", KERNEL_SCHEDULE, omp_sched_static, 0, 0 },
+    { "dynamic_1024", KERNEL_SCHEDULE, omp_sched_dynamic, 1024, 0 },
+    { "guided", KERNEL_SCHEDULE, omp_sched_guided, 0, 0 },
+    { "taskloop", KERNEL_TASKLOOP, 0, 0, 0 },         // default number of tasks
+    { "taskloop_ntasks", KERNEL_TASKLOOP, 0, 8, 0 },  // num_tasks(8 * threads)
+    { "taskloop_grain", KERNEL_TASKLOOP_GRAIN, 0, 0, 1 }, // grainsize(cutoff)
+    { "tasks", KERNEL_TASKS, 0, 0, 1 },               // recursive, serial below cutoff
+    { "wide", KERNEL_WIDE, 0, 0, 0 },                 // 128-bit sum, see wide_sum.h
+};
+
+static const unsigned int num_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+// Everything a kernel run needs, passed to bench_measure() through its void* argument.
+typedef struct {
+    const kernel_info* kernel;
+    unsigned int thread_count;
+    unsigned long upper_bound;
+    unsigned long cutoff; // grainsize or serial cutoff of the task kernels
+    unsigned long result;
+} sum_run;
+
+static void run_kernel(void* arg) {
+    sum_run* run = arg;
+
+    switch (run->kernel->type) {
+    case KERNEL_CRITICAL:
+        run->result = sum_critical(run->upper_bound, run->thread_count);
+        break;
+    case KERNEL_REDUCTION:
+        run->result = sum_reduction(run->upper_bound, run->thread_count);
+        break;
+    case KERNEL_PARALLEL_FOR:
+        run->result = sum_parallel_for(run->upper_bound, run->thread_count);
+        break;
+    case KERNEL_SCHEDULE:
+        run->result = sum_schedule(run->upper_bound, run->thread_count, run->kernel->kind,
+                                   run->kernel->chunk_size);
+        break;
+    case KERNEL_TASKLOOP:
+        run->result = sum_taskloop(run->upper_bound, run->thread_count, 0,
+                                   (unsigned long)run->kernel->chunk_size * run->thread_count);
+        break;
+    case KERNEL_TASKLOOP_GRAIN:
+        run->result = sum_taskloop(run->upper_bound, run->thread_count, run->cutoff, 0);
+        break;
+    case KERNEL_TASKS:
+        run->result = sum_tasks(run->upper_bound, run->thread_count, run->cutoff);
+        break;
+    case KERNEL_WIDE:
+        // Checked like the others: the low 64 bits must match the (wrapped) expected sum.
+        run->result = (unsigned long)wide_sum_range(1, run->upper_bound, run->thread_count);
+        break;
+    }
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--threads LIST] [--sizes LIST] [--kernels LIST] [--cutoffs LIST] "
+            "[--warmup N] [--trials N]\n",
+            program);
+    fprintf(stderr, "Kernels:");
+    for (unsigned int k = 0; k < num_kernels; k++) {
+        fprintf(stderr, " %s", kernels[k].name);
+    }
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads[BENCH_MAX_LIST];
+    unsigned long sizes[BENCH_MAX_LIST] = { 1000000, 10000000, 100000000 };
+    int num_threads = bench_default_threads(threads, BENCH_MAX_LIST);
+    unsigned long cutoffs[BENCH_MAX_LIST] = { 1024, 16384, 262144 };
+    int num_sizes = 3;
+    int num_cutoffs = 3;
+    int selected[sizeof(kernels) / sizeof(kernels[0])];
+    bench_config config = { .warmup = 2, .trials = 10 };
+
+    for (unsigned int k = 0; k < num_kernels; k++) {
+        selected[k] = 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(argv[i], "--threads") == 0) {
+            num_threads = bench_parse_list(argv[++i], threads, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--sizes") == 0) {
+            num_sizes = bench_parse_list(argv[++i], sizes, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--cutoffs") == 0) {
+            num_cutoffs = bench_parse_list(argv[++i], cutoffs, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--warmup") == 0) {
+            config.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--trials") == 0) {
+            config.trials = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--kernels") == 0) {
+            // Comma-separated kernel names; only these are run.
+            char* list = argv[++i];
+            for (unsigned int k = 0; k < num_kernels; k++) {
+                selected[k] = 0;
+            }
+            for (char* name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+                unsigned int k = 0;
+                while (k < num_kernels && strcmp(kernels[k].name, name) != 0) {
+                    k++;
+                }
+                if (k == num_kernels) {
+                    fprintf(stderr, "Unknown kernel: %s\n", name);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                selected[k] = 1;
+            }
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (num_threads < 0 || num_sizes < 0 || num_cutoffs < 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    bench_csv_header(stdout);
+
+    for (unsigned int k = 0; k < num_kernels; k++) {
+        if (!selected[k]) {
+            continue;
+        }
+
+        // Kernels without a cutoff run once per size; the others once per size and cutoff.
+        int runs = kernels[k].uses_cutoff ? num_cutoffs : 1;
+
+        for (int s = 0; s < num_sizes; s++) {
+            for (int c = 0; c < runs; c++) {
+                sum_run run = { .kernel = &kernels[k], .upper_bound = sizes[s] };
+                bench_result serial, result;
+                char name[64];
+
+                if (kernels[k].uses_cutoff) {
+                    run.cutoff = cutoffs[c];
+                    snprintf(name, sizeof(name), "%s_%lu", kernels[k].name, run.cutoff);
+                } else {
+                    snprintf(name, sizeof(name), "%s", kernels[k].name);
+                }
+
+                // Reference time on 1 thread for speedup and efficiency.
+                run.thread_count = 1;
+                bench_measure(&config, run_kernel, &run, &serial);
+
+                for (int t = 0; t < num_threads; t++) {
+                    run.thread_count = threads[t];
+                    if (run.thread_count == 1) {
+                        result = serial;
+                    } else {
+                        bench_measure(&config, run_kernel, &run, &result);
+                    }
+
+                    if (run.result != sum_expected(run.upper_bound)) {
+                        fprintf(stderr, "%s: incorrect result for %u threads, upper_bound %lu\n",
+                                name, run.thread_count, run.upper_bound);
+                        return EXIT_FAILURE;
+                    }
+
+                    bench_csv_row(stdout, name, run.thread_count, run.upper_bound, &result,
+                                  serial.median);
+                }
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
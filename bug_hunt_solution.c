@@ -6,27 +6,203 @@
  * This file contains the corrected version of bug_hunt.c with all 5 bugs identified and fixed.
  *
  * Compile:
- *  gcc -Wall -Wextra -fopenmp -o bug_hunt_solution bug_hunt_solution.c
+ *  gcc -Wall -Wextra -fopenmp -o bug_hunt_solution bug_hunt_solution.c perf_counters.c \
+ *      arena.c pipeline.c placement.c scan.c series_file.c stats.c triangular.c
  * OR
  *  make bug_hunt_solution
- * Run:     ./bug_hunt_solution <n> <thread_count>
+ * Run:     ./bug_hunt_solution <n> <thread_count> [--stream | --pipeline FILE] [--perf] [--numa]
+ *                                                  [--huge]
  * Example: ./bug_hunt_solution 100 4
  *
  * NOTE: n must be >= 6 because the program accesses array[5] in the output.
+ *
+ * With "--stream" the program does not store the array at all. Each thread generates its part of
+ * the series on the fly and reduces it directly (see triangular.h), so memory use is constant and
+ * n can go to billions:
+ *      ./bug_hunt_solution 4000000000 8 --stream
+ *
+ * With "--pipeline FILE" the series is also saved to FILE. Generating, summarizing and writing
+ * chunks of the series run as OpenMP tasks with dependencies, so computation overlaps the disk
+ * writes (see pipeline.h). The file can be memory-mapped by other programs (see series_file.h);
+ * this program maps it back to print the elements.
+ *
+ * With "--perf" the statistics pass over the array is measured with per-thread hardware counters
+ * (cycles, instructions, cache and branch misses, see perf_counters.h) to show whether it is
+ * limited by memory bandwidth, cache misses or imbalance.
+ *
+ * With "--numa" the program also prints, for every thread, the CPU and NUMA node it runs on and the
+ * nodes of the pages of its part of the array (see placement.h). Bind the threads to see a stable
+ * picture, e.g. OMP_PROC_BIND=spread OMP_PLACES=cores. numa_bench.c measures the difference between
+ * a serial and a parallel (first-touch) initialization for different bindings.
+ *
+ * The array comes from an arena (see arena.h): 64-byte aligned and on transparent huge pages, which
+ * cuts the TLB misses of the passes over it. With "--huge" the arena takes explicit huge pages from
+ * /proc/sys/vm/nr_hugepages instead (falling back to transparent ones if none are reserved). With
+ * "--perf" the program prints which pages the array got. arena_bench.c compares it with malloc().
  */
 
-#include <limits.h>
 #include <omp.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "perf_counters.h"
+#include "pipeline.h"
+#include "placement.h"
+#include "scan.h"
+#include "series_file.h"
+#include "stats.h"
+#include "triangular.h"
+
+// Print the first six elements, the last element and the statistics.
+static void print_results(const unsigned long* head, unsigned long n, unsigned long last,
+                          const stats* result) {
+    for (int i = 0; i < 6; i++) {
+        printf("Array[%d]:   %lu\n", i, head[i]);
+    }
+    printf("...\n");
+    printf("Array[%lu]:  %lu\n", n - 1, last);
+    printf("Sum:        %lu\n", result->sum);
+    printf("Min:        %lu\n", result->min);
+    printf("Max:        %lu\n", result->max);
+    // The mean is accumulated in floating point, so it stays correct even when the integer sum
+    // wraps around for very large n.
+    printf("Average:    %.2f\n", result->mean);
+    printf("Even count: %lu\n", result->even_count);
+    printf("Variance:   %.2f\n", stats_variance(result));
+    printf("Histogram (values by bit width):\n");
+    stats_print_histogram(result);
+}
+
+// The same pass as stats_compute(), with hardware counters around each thread's share of it.
+static void stats_with_counters(const unsigned long* data, unsigned long n,
+                                unsigned int thread_count, stats* result) {
+    stats total;
+    stats_init(&total);
+    unsigned long num_blocks = (n + STATS_BLOCK - 1) / STATS_BLOCK;
+
+    perf_region region;
+    perf_region_init(&region, thread_count);
+    double start = omp_get_wtime();
+
+#pragma omp parallel num_threads(thread_count) reduction(stats_merge : total)
+    {
+        perf_thread_state state;
+        perf_thread_begin(&region, &state);
+
+#pragma omp for schedule(static) nowait
+        for (unsigned long b = 0; b < num_blocks; b++) {
+            unsigned long block_start = b * STATS_BLOCK;
+            unsigned long count = n - block_start < STATS_BLOCK ? n - block_start : STATS_BLOCK;
+            stats_add_block(&total, data + block_start, count);
+        }
+
+        perf_thread_end(&region, &state);
+    }
+
+    double elapsed = omp_get_wtime() - start;
+    double mib = n * sizeof(unsigned long) / (1024.0 * 1024.0);
+    printf("Statistics pass: %.1f MiB in %.6f s (%.1f MiB/s)\n", mib, elapsed, mib / elapsed);
+    perf_region_report(&region, elapsed);
+    printf("\n");
+    perf_region_free(&region);
+
+    *result = total;
+}
+
+// Print where the threads run and on which NUMA nodes the pages of their blocks are.
+static void print_placement(const unsigned long* array, unsigned long n,
+                            unsigned int thread_count) {
+    placement_thread* threads = calloc(thread_count, sizeof(placement_thread));
+
+    // A new team, but with OMP_PROC_BIND set its threads run where the earlier ones did.
+    unsigned int team_size = thread_count;
+#pragma omp parallel num_threads(thread_count)
+    {
+        placement_record_thread(threads);
+#pragma omp single
+        team_size = omp_get_num_threads();
+    }
+
+    printf("\n");
+    placement_report(stdout, array, n, sizeof(unsigned long), STATS_BLOCK, threads, team_size, 16);
+    free(threads);
+}
+
+// Streaming mode: statistics without storing the array.
+static int run_stream(unsigned long n, unsigned int thread_count) {
+    stats result;
+    triangular_stream_stats(n, thread_count, &result);
+
+    unsigned long head[6];
+    for (int i = 0; i < 6; i++) {
+        head[i] = triangular(i);
+    }
+    print_results(head, n, triangular(n - 1), &result);
+
+    return EXIT_SUCCESS;
+}
+
+// Pipeline mode: save the series to a file while computing its statistics.
+static int run_pipeline(unsigned long n, unsigned int thread_count, const char* path) {
+    stats result;
+
+    double start = omp_get_wtime();
+    if (pipeline_run(path, n, thread_count, &result) != 0) {
+        return EXIT_FAILURE;
+    }
+    double elapsed = omp_get_wtime() - start;
+
+    // Read the elements back from the file without copying it.
+    series_view view;
+    if (series_map(path, &view) != 0) {
+        return EXIT_FAILURE;
+    }
+    print_results(view.data, n, view.data[n - 1], &result);
+    series_unmap(&view);
+
+    double mib = n * sizeof(unsigned long) / (1024.0 * 1024.0);
+    printf("Wrote %.1f MiB to %s in %.3f s (%.1f MiB/s)\n", mib, path, elapsed, mib / elapsed);
+
+    return EXIT_SUCCESS;
+}
+
+static void usage(const char* program) {
+    printf("Usage: %s <n> <thread_count> [--stream | --pipeline FILE] [--perf] [--numa] [--huge]\n",
+           program);
+}
 
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        printf("Usage: %s <n> <thread_count>\n", argv[0]);
+    if (argc < 3) {
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
 
-    unsigned int n = atoi(argv[1]);
+    int stream = 0;
+    int perf = 0;
+    int numa = 0;
+    arena_pages pages = ARENA_TRANSPARENT_HUGE;
+    const char* pipeline_path = NULL;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--stream") == 0) {
+            stream = 1;
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            perf = 1;
+        } else if (strcmp(argv[i], "--numa") == 0) {
+            numa = 1;
+        } else if (strcmp(argv[i], "--huge") == 0) {
+            pages = ARENA_EXPLICIT_HUGE;
+        } else if (strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc) {
+            pipeline_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    unsigned long n = atol(argv[1]);
     unsigned int thread_count = atoi(argv[2]);
 
     if (n < 6) {
@@ -34,26 +210,50 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
-    unsigned long* array = malloc(n * sizeof(unsigned long));
+    if (stream) {
+        return run_stream(n, thread_count);
+    }
+    if (pipeline_path != NULL) {
+        return run_pipeline(n, thread_count, pipeline_path);
+    }
+
+    arena arena;
+    if (arena_init(&arena, n * sizeof(unsigned long), pages) != 0) {
+        perror("arena_init");
+        return EXIT_FAILURE;
+    }
+    unsigned long* array = arena_alloc(&arena, n * sizeof(unsigned long), ARENA_ALIGN);
 
     /*
      * BUG 1 (Loop-carried dependency): array[i] depends on array[i-1], so each iteration needs the
      * result of the previous iteration. This is a loop-carried dependency and CANNOT be correctly
      * parallelized with a simple parallel for. Threads may read array[i-1] before another thread
      * has written it, producing garbage values.
-     * Fix: Remove the parallel for and compute sequentially. This loop is inherently serial due to
-     * the dependency. (Note: There are advanced techniques like parallel prefix sums that can
-     * parallelize this pattern, but they are beyond the scope of this tutorial.)
+     * Simple fix: Remove the parallel for and compute sequentially.
+     *
+     * Better fix: the dependency is only through a running total. array[i] = (1) + (2) + ... +
+     * (i + 1) is a prefix sum of the values i + 1, and addition is associative, so the running
+     * total can be computed in parallel with a two-pass blocked scan (see scan.h): each thread
+     * sums its own block, the block sums are turned into starting offsets, and each thread then
+     * fills its block from its offset. The result is identical to the serial loop.
+     *
+     * First we fill array[i] with the values being summed. There is no dependency here, so a plain
+     * parallel for works. It goes over the same blocks with the same schedule(static) as
+     * stats_compute() below (and nearly the same blocks as the scan), so that every thread is the
+     * first to touch the part of the array it works on later. On a NUMA machine the pages then
+     * land on the node of the thread that uses them (see placement.h); "--numa" shows where.
      */
-    array[0] = 1;
-    for (unsigned int i = 1; i < n; i++) {
-        array[i] = array[i - 1] + (i + 1);
+    unsigned long num_blocks = (n + STATS_BLOCK - 1) / STATS_BLOCK;
+#pragma omp parallel for num_threads(thread_count) schedule(static)
+    for (unsigned long b = 0; b < num_blocks; b++) {
+        unsigned long end = (b + 1) * STATS_BLOCK < n ? (b + 1) * STATS_BLOCK : n;
+        for (unsigned long i = b * STATS_BLOCK; i < end; i++) {
+            array[i] = i + 1;
+        }
     }
 
-    unsigned long sum = 0;
-    unsigned long min_val = ULONG_MAX;
-    unsigned long max_val = 0;
-    unsigned int even_count = 0;
+    // Then we replace the values with their running total in place.
+    scan_inclusive(array, array, n, thread_count);
 
     /*
      * BUG 2 (Race condition on sum): sum was updated by all threads simultaneously without any
@@ -72,45 +272,29 @@ int main(int argc, char* argv[]) {
      * BUG 5 (Race condition on min_val and max_val): min_val and max_val were compared and updated
      * by all threads without protection.
      * Fix: reduction(min:min_val) reduction(max:max_val)
+     *
+     * Going further: instead of one reduction clause per statistic, all statistics live in one
+     * struct (see stats.h) with a user-defined reduction created by "#pragma omp declare
+     * reduction". stats_compute() reads the array once, in cache-sized blocks, with an "omp simd"
+     * loop per block, and also computes the variance and a histogram in the same pass. Every
+     * thread works on its own private copy of the struct, so BUGs 2 to 5 cannot happen.
      */
-    unsigned long temp;
-
-#pragma omp parallel for num_threads(thread_count) private(temp) reduction(+ : sum, even_count)    \
-    reduction(min : min_val) reduction(max : max_val)
-    for (unsigned int i = 0; i < n; i++) {
-        temp = array[i];
-
-        sum += temp;
-
-        if (temp < min_val) {
-            min_val = temp;
-        }
+    stats result;
+    if (perf) {
+        printf("Array: %.1f MiB, %s pages, %.1f MiB of its mapping on huge pages\n",
+               n * sizeof(unsigned long) / (1024.0 * 1024.0), arena_pages_name(arena.pages),
+               arena_huge_bytes(array) / (1024.0 * 1024.0));
+        stats_with_counters(array, n, thread_count, &result);
+    } else {
+        stats_compute(array, n, thread_count, &result);
+    }
 
-        if (temp > max_val) {
-            max_val = temp;
-        }
+    print_results(array, n, array[n - 1], &result);
 
-        if (temp % 2 == 0) {
-            even_count++;
-        }
+    if (numa) {
+        print_placement(array, n, thread_count);
     }
 
-    double average = (double)sum / n;
-
-    printf("Array[0]:   %lu\n", array[0]);
-    printf("Array[1]:   %lu\n", array[1]);
-    printf("Array[2]:   %lu\n", array[2]);
-    printf("Array[3]:   %lu\n", array[3]);
-    printf("Array[4]:   %lu\n", array[4]);
-    printf("Array[5]:   %lu\n", array[5]);
-    printf("...\n");
-    printf("Array[%u]:  %lu\n", n - 1, array[n - 1]);
-    printf("Sum:        %lu\n", sum);
-    printf("Min:        %lu\n", min_val);
-    printf("Max:        %lu\n", max_val);
-    printf("Average:    %.2f\n", average);
-    printf("Even count: %u\n", even_count);
-
-    free(array);
+    arena_destroy(&arena);
     return EXIT_SUCCESS;
 }
\ No newline at end of file
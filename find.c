@@ -0,0 +1,93 @@
+/*
+ * Parallel search with early exit. See find.h.
+ */
+
+#include "find.h"
+
+#include <stdatomic.h>
+
+unsigned long find_serial(const unsigned long* data, unsigned long n, find_predicate predicate,
+                          const void* arg) {
+    for (unsigned long i = 0; i < n; i++) {
+        if (predicate(data[i], arg)) {
+            return i;
+        }
+    }
+    return n;
+}
+
+// The first match in data[start..end), or end if there is none. A serial loop, so it may stop
+// early.
+static unsigned long scan_block(const unsigned long* data, unsigned long start, unsigned long end,
+                                find_predicate predicate, const void* arg) {
+    for (unsigned long i = start; i < end; i++) {
+        if (predicate(data[i], arg)) {
+            return i;
+        }
+    }
+    return end;
+}
+
+// Lower *best to index if index is smaller.
+static void atomic_min(atomic_ulong* best, unsigned long index) {
+    unsigned long current = atomic_load_explicit(best, memory_order_relaxed);
+    while (index < current
+           && !atomic_compare_exchange_weak_explicit(best, &current, index, memory_order_relaxed,
+                                                     memory_order_relaxed)) {
+        // current now holds the value another thread stored; try again if we are still smaller.
+    }
+}
+
+unsigned long find_any_cancel(const unsigned long* data, unsigned long n, find_predicate predicate,
+                              const void* arg, unsigned int thread_count) {
+    unsigned long num_blocks = (n + FIND_BLOCK - 1) / FIND_BLOCK;
+    atomic_ulong found = n;
+
+#pragma omp parallel num_threads(thread_count)
+    {
+        // schedule(static): every thread starts at the beginning of its own part of the array, so
+        // a match anywhere is found after scanning at most one part.
+#pragma omp for schedule(static)
+        for (unsigned long b = 0; b < num_blocks; b++) {
+            // Leave the loop if another thread has cancelled it.
+#pragma omp cancellation point for
+
+            unsigned long start = b * FIND_BLOCK;
+            unsigned long end = n - start < FIND_BLOCK ? n : start + FIND_BLOCK;
+            unsigned long index = scan_block(data, start, end, predicate, arg);
+            if (index < end) {
+                // Two threads may both find a match before they see the cancellation; keep the
+                // smaller one, so the result is at least a valid match.
+                atomic_min(&found, index);
+#pragma omp cancel for
+            }
+        }
+    }
+
+    return atomic_load(&found);
+}
+
+unsigned long find_first_blocked(const unsigned long* data, unsigned long n,
+                                 find_predicate predicate, const void* arg,
+                                 unsigned int thread_count) {
+    unsigned long num_blocks = (n + FIND_BLOCK - 1) / FIND_BLOCK;
+    atomic_ulong best = n;
+
+    // schedule(dynamic) hands out the blocks in increasing order, so the blocks before a match are
+    // scanned first and the blocks after it are skipped as soon as it is found.
+#pragma omp parallel for num_threads(thread_count) schedule(dynamic)
+    for (unsigned long b = 0; b < num_blocks; b++) {
+        unsigned long start = b * FIND_BLOCK;
+        if (start >= atomic_load_explicit(&best, memory_order_relaxed)) {
+            continue; // a match before this block is known already
+        }
+
+        unsigned long end = n - start < FIND_BLOCK ? n : start + FIND_BLOCK;
+        unsigned long index = scan_block(data, start, end, predicate, arg);
+        if (index < end) {
+            atomic_min(&best, index);
+        }
+    }
+
+    return atomic_load(&best);
+}
@@ -0,0 +1,50 @@
+/*
+ * Parallel search with early exit: the first (or any) index i where a predicate holds for data[i].
+ *
+ * parallel_for.c explains that a parallel loop must be in canonical form, so "break" is not
+ * allowed: the runtime divides the iterations before the loop starts and cannot stop the other
+ * threads when one of them finds what it looks for. A serial loop can stop at the first match, so a
+ * naive parallel search (scan everything, then take the smallest match) is often slower than the
+ * serial one. Two ways out:
+ *
+ *      find_any_cancel     -- every thread scans its own part of the array. The thread that finds a
+ *                             match executes "#pragma omp cancel for"; the others reach a
+ *                             "#pragma omp cancellation point for" before every block and leave
+ *                             the loop. The result is a match, but not necessarily the first one:
+ *                             it depends on which thread gets there first. Cancellation only works
+ *                             if the program was started with OMP_CANCELLATION=true; otherwise the
+ *                             cancel directives do nothing and every thread scans its whole part.
+ *      find_first_blocked  -- the threads take blocks of FIND_BLOCK elements in order
+ *                             (schedule(dynamic)) and keep the best (smallest) match in an atomic
+ *                             variable. A block that starts after the best match so far cannot
+ *                             contain a better one and is skipped. Every block before the best
+ *                             match is always scanned, so the result is the first match, exactly
+ *                             as in the serial loop, for any number of threads. No cancellation
+ *                             is needed.
+ *
+ * Inside a block the scan is an ordinary serial loop, which may "break". The functions return n if
+ * there is no match.
+ */
+
+#ifndef FIND_H
+#define FIND_H
+
+#define FIND_BLOCK 4096 // elements per block: between two cancellation points or best-match checks
+
+// Does value satisfy the predicate? arg is passed through unchanged.
+typedef int (*find_predicate)(unsigned long value, const void* arg);
+
+// The first match, with a serial loop that stops there.
+unsigned long find_serial(const unsigned long* data, unsigned long n, find_predicate predicate,
+                          const void* arg);
+
+// Some match (not necessarily the first), with omp cancel for.
+unsigned long find_any_cancel(const unsigned long* data, unsigned long n, find_predicate predicate,
+                              const void* arg, unsigned int thread_count);
+
+// The first match, with blocks and an atomic best index.
+unsigned long find_first_blocked(const unsigned long* data, unsigned long n,
+                                 find_predicate predicate, const void* arg,
+                                 unsigned int thread_count);
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Benchmark of the parallel searches of find.h against the serial scan.
+ *
+ * The array is the triangular series of bug_hunt_solution.c (array[i] = 1 + 2 + ... + (i + 1)),
+ * and the query is "the first index i where array[i] equals a value". The value is chosen so that
+ * the match is at the beginning (0.1% into the array), the middle or the end, or so that there is
+ * no match. The serial scan stops at the match, so a match at the beginning is nearly free for it,
+ * while the parallel versions still pay for starting a team: the interesting rows are where the
+ * parallel versions win and where they lose.
+ *
+ * For every kernel, hit position and thread count the program prints the time, the speedup over
+ * the serial scan, the index found and whether it is right: a match for find_any_cancel, the first
+ * match for find_first_blocked.
+ *
+ * "omp cancel" only works if OMP_CANCELLATION=true when the program starts. If the variable is not
+ * set, the program runs itself again with OMP_CANCELLATION=true. Set OMP_CANCELLATION=false to see
+ * find_any_cancel without cancellation.
+ *
+ * Compile:
+ *  make find_bench
+ * Run:     ./find_bench [--threads LIST] [--size N] [--warmup N] [--trials N]
+ * Example: ./find_bench --threads 1,2,4,8 --size 100000000 > find.csv
+ */
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "find.h"
+#include "triangular.h"
+
+typedef enum { KERNEL_SERIAL, KERNEL_ANY_CANCEL, KERNEL_FIRST_BLOCKED } kernel_type;
+
+static const char* const kernel_names[] = { "serial", "any_cancel", "first_blocked" };
+
+typedef struct {
+    kernel_type type;
+    const unsigned long* data;
+    unsigned long n;
+    unsigned long target;
+    unsigned int thread_count;
+    unsigned long result;
+} find_run;
+
+static int equals(unsigned long value, const void* arg) {
+    return value == *(const unsigned long*)arg;
+}
+
+static void run_kernel(void* arg) {
+    find_run* run = arg;
+    switch (run->type) {
+    case KERNEL_SERIAL:
+        run->result = find_serial(run->data, run->n, equals, &run->target);
+        break;
+    case KERNEL_ANY_CANCEL:
+        run->result = find_any_cancel(run->data, run->n, equals, &run->target, run->thread_count);
+        break;
+    case KERNEL_FIRST_BLOCKED:
+        run->result =
+            find_first_blocked(run->data, run->n, equals, &run->target, run->thread_count);
+        break;
+    }
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--threads LIST] [--size N] [--warmup N] [--trials N]\n", program);
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads[BENCH_MAX_LIST];
+    int num_threads = bench_default_threads(threads, BENCH_MAX_LIST);
+    unsigned long n = 1UL << 25; // 256 MiB
+    bench_config config = { .warmup = 1, .trials = 5 };
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(argv[i], "--threads") == 0) {
+            num_threads = bench_parse_list(argv[++i], threads, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--size") == 0) {
+            n = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--warmup") == 0) {
+            config.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--trials") == 0) {
+            config.trials = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (num_threads < 0 || n < 1000) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // The runtime reads OMP_CANCELLATION only when it starts.
+    if (!omp_get_cancellation() && getenv("OMP_CANCELLATION") == NULL) {
+        const char* name = "OMP_CANCELLATION";
+        const char* value = "true";
+        return bench_run_self(argv, 1, &name, &value) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    unsigned long* data = malloc(n * sizeof(unsigned long));
+    if (data == NULL) {
+        fprintf(stderr, "Cannot allocate %lu numbers\n", n);
+        return EXIT_FAILURE;
+    }
+#pragma omp parallel for schedule(static)
+    for (unsigned long i = 0; i < n; i++) {
+        data[i] = triangular(i);
+    }
+
+    // The series is strictly increasing (for n below about 6 * 10^9), so T(i) is only at index i.
+    // 2 is not a triangular number.
+    const struct {
+        const char* name;
+        unsigned long index;
+    } hits[] = { { "begin", n / 1000 }, { "middle", n / 2 }, { "end", n - 1 }, { "none", n } };
+
+    printf("kernel,threads,size,hit,index_expected,cancellation,min_s,median_s,p95_s,speedup,"
+           "index_found,correct\n");
+
+    for (unsigned int h = 0; h < sizeof(hits) / sizeof(hits[0]); h++) {
+        unsigned long expected = hits[h].index;
+        find_run run = { .data = data, .n = n };
+        run.target = expected < n ? triangular(expected) : 2;
+
+        // The serial scan once, as the baseline for every thread count.
+        run.type = KERNEL_SERIAL;
+        run.thread_count = 1;
+        bench_result serial;
+        bench_measure(&config, run_kernel, &run, &serial);
+        printf("%s,1,%lu,%s,%lu,%s,%.9f,%.9f,%.9f,1.000,%lu,%s\n", kernel_names[KERNEL_SERIAL],
+               n, hits[h].name, expected, omp_get_cancellation() ? "yes" : "no", serial.min,
+               serial.median, serial.p95, run.result, run.result == expected ? "yes" : "no");
+        fflush(stdout);
+
+        for (int t = 0; t < num_threads; t++) {
+            for (int k = KERNEL_ANY_CANCEL; k <= KERNEL_FIRST_BLOCKED; k++) {
+                run.type = k;
+                run.thread_count = threads[t];
+                bench_result result;
+                bench_measure(&config, run_kernel, &run, &result);
+
+                // Any match is right for find_any_cancel; the value occurs only once anyway.
+                int correct = run.result == expected;
+                if (k == KERNEL_ANY_CANCEL && run.result < n) {
+                    correct = data[run.result] == run.target;
+                }
+                printf("%s,%u,%lu,%s,%lu,%s,%.9f,%.9f,%.9f,%.3f,%lu,%s\n", kernel_names[k],
+                       run.thread_count, n, hits[h].name, expected,
+                       omp_get_cancellation() ? "yes" : "no", result.min, result.median,
+                       result.p95, serial.median / result.median, run.result,
+                       correct ? "yes" : "no");
+                fflush(stdout);
+            }
+        }
+    }
+
+    free(data);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+/*
+ * Reproducible floating-point sums. See fsum.h.
+ */
+
+#include "fsum.h"
+
+#include <math.h>
+#include <omp.h>
+#include <stdlib.h>
+
+// A sum and the rounding error accumulated while computing it.
+typedef struct {
+    double sum;
+    double error;
+} fsum_pair;
+
+double fsum_plain(const double* values, unsigned long n, unsigned int thread_count) {
+    double sum = 0.0;
+
+#pragma omp parallel for num_threads(thread_count) reduction(+ : sum)
+    for (unsigned long i = 0; i < n; i++) {
+        sum += values[i];
+    }
+
+    return sum;
+}
+
+// Add x to (sum, error) and keep the rounding error of the addition (Neumaier): the smaller of the
+// two operands is the one that lost bits.
+static inline void neumaier_add(double* sum, double* error, double x) {
+    double t = *sum + x;
+    *error += fabs(*sum) >= fabs(x) ? (*sum - t) + x : (x - t) + *sum;
+    *sum = t;
+}
+
+static fsum_pair combine_pairs(fsum_pair a, fsum_pair b, int compensated) {
+    if (!compensated) {
+        return (fsum_pair){ a.sum + b.sum, 0.0 };
+    }
+
+    fsum_pair result = { a.sum, a.error + b.error };
+    neumaier_add(&result.sum, &result.error, b.sum);
+    return result;
+}
+
+// Sum of one block, always in the same order: lane l gets numbers l, l + FSUM_LANES, ... and the
+// lanes are combined pairwise. Sums and errors are separate arrays so that the lanes are
+// contiguous and the lane loops can use SIMD instructions.
+static fsum_pair block_sum(const double* x, unsigned long count, int compensated) {
+    double sum[FSUM_LANES] = { 0.0 };
+    double error[FSUM_LANES] = { 0.0 };
+
+    unsigned long full = count - count % FSUM_LANES;
+    if (compensated) {
+        for (unsigned long i = 0; i < full; i += FSUM_LANES) {
+            for (int l = 0; l < FSUM_LANES; l++) {
+                neumaier_add(&sum[l], &error[l], x[i + l]);
+            }
+        }
+        for (unsigned long i = full; i < count; i++) {
+            neumaier_add(&sum[i - full], &error[i - full], x[i]);
+        }
+    } else {
+        for (unsigned long i = 0; i < full; i += FSUM_LANES) {
+            for (int l = 0; l < FSUM_LANES; l++) {
+                sum[l] += x[i + l];
+            }
+        }
+        for (unsigned long i = full; i < count; i++) {
+            sum[i - full] += x[i];
+        }
+    }
+
+    fsum_pair lanes[FSUM_LANES];
+    for (int l = 0; l < FSUM_LANES; l++) {
+        lanes[l] = (fsum_pair){ sum[l], error[l] };
+    }
+    for (int width = FSUM_LANES / 2; width > 0; width /= 2) {
+        for (int l = 0; l < width; l++) {
+            lanes[l] = combine_pairs(lanes[l], lanes[l + width], compensated);
+        }
+    }
+    return lanes[0];
+}
+
+static double fsum_blocked(const double* values, unsigned long n, unsigned int thread_count,
+                           int compensated) {
+    unsigned long num_blocks = (n + FSUM_BLOCK - 1) / FSUM_BLOCK;
+    if (num_blocks == 0) {
+        return 0.0;
+    }
+
+    // Two buffers for the levels of the tree: a level reads one and writes the other.
+    fsum_pair* level = malloc(num_blocks * sizeof(fsum_pair));
+    fsum_pair* next = malloc((num_blocks + 1) / 2 * sizeof(fsum_pair));
+    fsum_pair* first = level;
+    fsum_pair* second = next;
+    fsum_pair* result = first;
+
+#pragma omp parallel num_threads(thread_count) firstprivate(level, next)
+    {
+        // Any thread may sum any block: block b always covers the same numbers.
+#pragma omp for schedule(static)
+        for (unsigned long b = 0; b < num_blocks; b++) {
+            unsigned long start = b * FSUM_BLOCK;
+            unsigned long count = n - start < FSUM_BLOCK ? n - start : FSUM_BLOCK;
+            level[b] = block_sum(values + start, count, compensated);
+        }
+
+        // The pairwise tree, one level per loop. Every thread runs the same levels (count is the
+        // same in all threads), and the implicit barrier of each "for" completes a level before the
+        // next one reads it. An odd element at the end is carried to the next level unchanged.
+        for (unsigned long count = num_blocks; count > 1; count = (count + 1) / 2) {
+#pragma omp for schedule(static)
+            for (unsigned long i = 0; i < (count + 1) / 2; i++) {
+                next[i] = 2 * i + 1 < count
+                              ? combine_pairs(level[2 * i], level[2 * i + 1], compensated)
+                              : level[2 * i];
+            }
+
+            fsum_pair* swap = level;
+            level = next;
+            next = swap;
+        }
+
+        // Every thread's "level" now points to the same buffer, which holds the root.
+        if (omp_get_thread_num() == 0) {
+            result = level;
+        }
+    }
+
+    double sum = result[0].sum + result[0].error;
+    free(first);
+    free(second);
+    return sum;
+}
+
+double fsum_reproducible(const double* values, unsigned long n, unsigned int thread_count) {
+    return fsum_blocked(values, n, thread_count, 0);
+}
+
+double fsum_compensated(const double* values, unsigned long n, unsigned int thread_count) {
+    return fsum_blocked(values, n, thread_count, 1);
+}
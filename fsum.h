@@ -0,0 +1,43 @@
+/*
+ * Floating-point sums that give the same bits on any number of threads.
+ *
+ * reduction.c warns that a floating-point reduction is not deterministic. Floating-point addition
+ * is not associative ((a + b) + c is not always a + (b + c)), and reduction(+ : x) adds the
+ * numbers in an order that depends on the number of threads (every thread sums its own part, then
+ * the parts are combined in whatever order the threads finish). On 4 and on 64 threads the last
+ * digits of the result usually differ.
+ *
+ * The reproducible versions fix the order of the additions, independent of the threads:
+ *
+ *      1. Split the array into blocks of FSUM_BLOCK numbers. Block b always covers the same
+ *         numbers, and every block is summed in the same order (FSUM_LANES interleaved partial
+ *         sums, combined pairwise; the lanes also let the compiler use SIMD instructions).
+ *      2. Combine the block sums in a fixed pairwise tree: (b0 + b1), (b2 + b3), ... then those
+ *         pairs, and so on.
+ *
+ * Which thread sums which block does not matter, so the result is bitwise identical for any
+ * number of threads and any schedule. (It can still change with the compiler flags: do not use
+ * -ffast-math, which allows the compiler to reorder additions.)
+ *
+ * The compensated version does the same with Neumaier's variant of Kahan summation: every partial
+ * sum carries the rounding error of its additions, which is added back at the end. It is both
+ * reproducible and much more accurate, at the cost of a few more operations per number.
+ *
+ *      fsum_plain          -- parallel for reduction(+ : sum), for comparison
+ *      fsum_reproducible   -- fixed blocks, fixed pairwise tree
+ *      fsum_compensated    -- fixed blocks, fixed pairwise tree, Neumaier compensation
+ */
+
+#ifndef FSUM_H
+#define FSUM_H
+
+#define FSUM_BLOCK 1024 // numbers per block; changing it changes the (reproducible) result
+#define FSUM_LANES 8    // partial sums per block, a power of 2
+
+double fsum_plain(const double* values, unsigned long n, unsigned int thread_count);
+
+double fsum_reproducible(const double* values, unsigned long n, unsigned int thread_count);
+
+double fsum_compensated(const double* values, unsigned long n, unsigned int thread_count);
+
+#endif
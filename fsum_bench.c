@@ -0,0 +1,149 @@
+/*
+ * Benchmark of the floating-point sums of fsum.h: plain reduction(+ : sum) vs the reproducible and
+ * the compensated versions.
+ *
+ * The numbers summed are 1/1, 1/2, 1/3, ... (the harmonic series), whose terms have very different
+ * magnitudes, so the order of the additions shows up in the last digits of the result. For every
+ * kernel and thread count the program prints the time, the slowdown relative to the plain
+ * reduction on the same number of threads, the result (as %.17g, which identifies every double
+ * exactly), whether the result has the same bits as on 1 thread, and the relative error against a
+ * reference computed serially in long double with compensation.
+ *
+ * Compile:
+ *  make fsum_bench
+ * Run:     ./fsum_bench [--threads LIST] [--sizes LIST] [--warmup N] [--trials N]
+ * Example: ./fsum_bench --threads 1,2,3,4,8 --sizes 10000000 > fsum.csv
+ */
+
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "fsum.h"
+
+typedef double (*fsum_kernel)(const double* values, unsigned long n, unsigned int thread_count);
+
+static const struct {
+    const char* name;
+    fsum_kernel kernel;
+} kernels[] = {
+    { "plain", fsum_plain },
+    { "reproducible", fsum_reproducible },
+    { "compensated", fsum_compensated },
+};
+
+static const unsigned int num_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+typedef struct {
+    fsum_kernel kernel;
+    const double* values;
+    unsigned long n;
+    unsigned int thread_count;
+    double result;
+} fsum_run;
+
+static void run_kernel(void* arg) {
+    fsum_run* run = arg;
+    run->result = run->kernel(run->values, run->n, run->thread_count);
+}
+
+// Serial Neumaier sum in long double: accurate enough to measure the error of the others.
+static long double reference_sum(const double* values, unsigned long n) {
+    long double sum = 0.0L;
+    long double error = 0.0L;
+    for (unsigned long i = 0; i < n; i++) {
+        long double t = sum + values[i];
+        error += fabsl(sum) >= fabsl(values[i]) ? (sum - t) + values[i] : (values[i] - t) + sum;
+        sum = t;
+    }
+    return sum + error;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--threads LIST] [--sizes LIST] [--warmup N] [--trials N]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads[BENCH_MAX_LIST];
+    unsigned long sizes[BENCH_MAX_LIST] = { 1000000, 10000000 };
+    int num_threads = bench_default_threads(threads, BENCH_MAX_LIST);
+    int num_sizes = 2;
+    bench_config config = { .warmup = 1, .trials = 5 };
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(argv[i], "--threads") == 0) {
+            num_threads = bench_parse_list(argv[++i], threads, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--sizes") == 0) {
+            num_sizes = bench_parse_list(argv[++i], sizes, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--warmup") == 0) {
+            config.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--trials") == 0) {
+            config.trials = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (num_threads < 0 || num_sizes < 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("kernel,threads,size,min_s,median_s,p95_s,slowdown,result,same_as_1_thread,"
+           "relative_error\n");
+
+    for (int s = 0; s < num_sizes; s++) {
+        unsigned long n = sizes[s];
+        double* values = malloc(n * sizeof(double));
+        if (values == NULL) {
+            fprintf(stderr, "Cannot allocate %lu numbers\n", n);
+            return EXIT_FAILURE;
+        }
+#pragma omp parallel for
+        for (unsigned long i = 0; i < n; i++) {
+            values[i] = 1.0 / (i + 1);
+        }
+        long double reference = reference_sum(values, n);
+
+        for (int t = 0; t < num_threads; t++) {
+            double plain_median = 0.0;
+
+            for (unsigned int k = 0; k < num_kernels; k++) {
+                fsum_run run = { .kernel = kernels[k].kernel, .values = values, .n = n };
+
+                // The 1-thread result, to check that the result does not depend on the threads.
+                run.thread_count = 1;
+                run_kernel(&run);
+                double serial_result = run.result;
+
+                run.thread_count = threads[t];
+                bench_result result;
+                bench_measure(&config, run_kernel, &run, &result);
+                if (k == 0) {
+                    plain_median = result.median;
+                }
+
+                printf("%s,%u,%lu,%.9f,%.9f,%.9f,%.3f,%.17g,%s,%.3Le\n", kernels[k].name,
+                       run.thread_count, n, result.min, result.median, result.p95,
+                       result.median / plain_median, run.result,
+                       memcmp(&run.result, &serial_result, sizeof(double)) == 0 ? "yes" : "no",
+                       fabsl((run.result - reference) / reference));
+                fflush(stdout);
+            }
+        }
+
+        free(values);
+    }
+
+    return EXIT_SUCCESS;
+}
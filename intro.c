@@ -26,21 +26,237 @@
  * To compile a program with OpenMP directives, we need to use the "-fopenmp" flag with the
  * compiler. For example, to compile this program, we can use the following command:
  *
- * gcc -fopenmp -o intro intro.c
+ * gcc -fopenmp -o intro intro.c placement.c
+ *
+ * Creating the team, and every barrier, takes time. overhead_bench.c measures how much each OpenMP
+ * construct costs on your machine.
+ *
+ * Where do the threads run? (./intro <num_threads> --affinity [upper_bound])
+ *
+ * The operating system may run a thread on any CPU and move it to another one at any time, unless
+ * the thread is bound. OpenMP binds threads to PLACES (OMP_PLACES: threads, cores, sockets or an
+ * explicit list of CPUs) with a policy (OMP_PROC_BIND, or the proc_bind clause of a parallel
+ * region):
+ *
+ *      spread -- spread the threads evenly over the places: most memory bandwidth and cache
+ *      close  -- put the threads on places next to the master's: threads share caches
+ *      master -- put all threads on the master's place (called "primary" since OpenMP 5.1)
+ *
+ * With "--affinity" the program prints, for every thread, what the runtime says about it
+ * (omp_capture_affinity(), omp_get_place_num(), omp_get_partition_place_nums()) and where it
+ * actually runs: the CPU (sched_getcpu()) and that CPU's core, socket and SMT siblings. On a shared
+ * machine this shows threads that share a core or are not where they should be. Then it runs the
+ * sum of reduction.c with each binding policy, checking every MIGRATION_CHECK numbers whether the
+ * thread has moved to another CPU, and prints the throughput of each policy. The runtime only binds
+ * threads if it has places, so run it with OMP_PLACES set, for example:
+ *
+ *      OMP_PLACES=cores ./intro 8 --affinity
  */
 
+#define _GNU_SOURCE // sched_getcpu()
+
 #include <omp.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "placement.h"
+#include "range.h"
+
+#define MIGRATION_CHECK 65536 // numbers summed between two sched_getcpu() calls
+#define AFFINITY_TRIALS 5
+
+// What one thread reports about itself.
+typedef struct {
+    int cpu;
+    int place;
+    int partition[64]; // omp_get_partition_place_nums()
+    int partition_count;
+    char affinity[128]; // omp_capture_affinity()
+    unsigned long migrations;
+} thread_info;
+
+// Print the places the runtime created from OMP_PLACES.
+static void print_places(void) {
+    int num_places = omp_get_num_places();
+    if (num_places == 0) {
+        printf("No places (OMP_PLACES is not set): the threads are not bound.\n");
+        return;
+    }
+
+    printf("%d places:", num_places);
+    for (int p = 0; p < num_places; p++) {
+        int count = omp_get_place_num_procs(p);
+        int* ids = malloc((count > 0 ? count : 1) * sizeof(int));
+        omp_get_place_proc_ids(p, ids);
+        printf(" %d={", p);
+        for (int k = 0; k < count; k++) {
+            printf(k > 0 ? ",%d" : "%d", ids[k]);
+        }
+        printf("}");
+        free(ids);
+    }
+    printf("\n");
+}
+
+// Print what the runtime and the operating system say about every thread of a team.
+static void show_affinity(unsigned int thread_count) {
+    thread_info* info = calloc(thread_count, sizeof(thread_info));
+    unsigned int team_size = thread_count;
+
+    print_places();
+#pragma omp parallel num_threads(thread_count)
+    {
+        thread_info* self = &info[omp_get_thread_num()];
+
+        // The text omp_display_affinity() prints (to stderr with GCC), captured so that the lines
+        // come out in thread order. %A is the list of CPUs the thread may run on.
+        omp_capture_affinity(self->affinity, sizeof(self->affinity), "{%A}");
+
+        self->cpu = sched_getcpu();
+        self->place = omp_get_place_num();
+        self->partition_count = omp_get_partition_num_places();
+        if (self->partition_count <= 64) {
+            omp_get_partition_place_nums(self->partition);
+        }
+#pragma omp single
+        team_size = omp_get_num_threads();
+    }
+
+    printf("\n%-6s %4s %5s %6s %-12s %-12s %5s %s\n", "thread", "cpu", "core", "socket",
+           "smt_siblings", "affinity", "place", "partition");
+    for (unsigned int t = 0; t < team_size; t++) {
+        placement_topology topology;
+        placement_cpu_topology(info[t].cpu, &topology);
+        printf("%-6u %4d %5d %6d %-12s %-12s %5d ", t, info[t].cpu, topology.core, topology.socket,
+               topology.siblings, info[t].affinity, info[t].place);
+        for (int k = 0; k < info[t].partition_count && k < 64; k++) {
+            printf(k > 0 ? ",%d" : "%d", info[t].partition[k]);
+        }
+        printf("\n");
+    }
+
+    free(info);
+}
+
+// The loop of reduction.c for the calling thread's block, calling sched_getcpu() every
+// MIGRATION_CHECK numbers to count how often the thread moves to another CPU.
+static unsigned long sum_block(unsigned long upper_bound, thread_info* info) {
+    thread_info* self = &info[omp_get_thread_num()];
+    unsigned long start, end;
+    range_block(upper_bound, omp_get_thread_num(), omp_get_num_threads(), &start, &end);
+
+    unsigned long sum = 0;
+    int cpu = sched_getcpu();
+    unsigned long migrations = 0;
+    for (unsigned long chunk = start; chunk < end; chunk += MIGRATION_CHECK) {
+        unsigned long chunk_end = end - chunk < MIGRATION_CHECK ? end : chunk + MIGRATION_CHECK;
+        for (unsigned long i = chunk + 1; i <= chunk_end; i++) {
+            sum += i;
+        }
+
+        int now = sched_getcpu();
+        migrations += now != cpu;
+        cpu = now;
+    }
+
+    self->cpu = cpu;
+    self->migrations += migrations;
+    return sum;
+}
+
+// The proc_bind clause takes a keyword, not a value, so every policy needs its own directive.
+static unsigned long sum_with_binding(int policy, unsigned long upper_bound,
+                                      unsigned int thread_count, thread_info* info) {
+    unsigned long sum = 0;
+
+    switch (policy) {
+    case 0:
+#pragma omp parallel num_threads(thread_count) reduction(+ : sum)
+        sum += sum_block(upper_bound, info);
+        break;
+    case 1:
+#pragma omp parallel num_threads(thread_count) proc_bind(spread) reduction(+ : sum)
+        sum += sum_block(upper_bound, info);
+        break;
+    case 2:
+#pragma omp parallel num_threads(thread_count) proc_bind(close) reduction(+ : sum)
+        sum += sum_block(upper_bound, info);
+        break;
+    default:
+#pragma omp parallel num_threads(thread_count) proc_bind(master) reduction(+ : sum)
+        sum += sum_block(upper_bound, info);
+        break;
+    }
+
+    return sum;
+}
+
+// Run the reduction kernel with every binding policy and print its throughput and migrations.
+static void compare_bindings(unsigned long upper_bound, unsigned int thread_count) {
+    static const char* const policies[] = { "default", "spread", "close", "master" };
+    thread_info* info = calloc(thread_count, sizeof(thread_info));
+    unsigned long expected_sum = upper_bound % 2 == 0 ? (upper_bound / 2) * (upper_bound + 1)
+                                                       : upper_bound * ((upper_bound + 1) / 2);
+    double default_rate = 0.0;
+
+    printf("\nSum of 1 to %lu, best of %d runs, migrations of all runs (\"default\" has no "
+           "proc_bind clause):\n",
+           upper_bound, AFFINITY_TRIALS);
+    printf("%-8s %10s %12s %10s %10s %-8s %s\n", "binding", "best_s", "Mnumbers/s", "vs_default",
+           "migrations", "result", "cpus");
+
+    for (int p = 0; p < 4; p++) {
+        memset(info, 0, thread_count * sizeof(thread_info));
+        double best = 0.0;
+        int correct = 1;
+        for (int trial = 0; trial < AFFINITY_TRIALS; trial++) {
+            double start = omp_get_wtime();
+            unsigned long sum = sum_with_binding(p, upper_bound, thread_count, info);
+            double elapsed = omp_get_wtime() - start;
+            best = trial == 0 || elapsed < best ? elapsed : best;
+            correct = correct && sum == expected_sum;
+        }
+
+        unsigned long migrations = 0;
+        for (unsigned int t = 0; t < thread_count; t++) {
+            migrations += info[t].migrations;
+        }
+        double rate = upper_bound / best / 1e6;
+        if (p == 0) {
+            default_rate = rate;
+        }
+
+        printf("%-8s %10.6f %12.1f %9.2fx %10lu %-8s ", policies[p], best, rate,
+               rate / default_rate, migrations, correct ? "correct" : "WRONG");
+        // The CPU every thread was on at the end of the last run.
+        for (unsigned int t = 0; t < thread_count; t++) {
+            printf(t > 0 ? ",%d" : "%d", info[t].cpu);
+        }
+        printf("\n");
+    }
+
+    free(info);
+}
 
 int main(int argc, char** argv) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <num_threads>\n", argv[0]);
+    int affinity = argc >= 3 && strcmp(argv[2], "--affinity") == 0;
+    // Get the number of threads from command line argument, and the upper bound of --affinity
+    int num_threads = argc >= 2 ? atoi(argv[1]) : 0;
+    unsigned long upper_bound = affinity && argc == 4 ? strtoul(argv[3], NULL, 10) : 200000000;
+    if ((argc != 2 && !(affinity && argc <= 4)) || num_threads < 1 || upper_bound == 0) {
+        fprintf(stderr, "Usage: %s <num_threads> [--affinity [upper_bound]]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
-    // Get the number of threads from command line argument
-    unsigned int thread_count = atoi(argv[1]);
+    unsigned int thread_count = num_threads;
+
+    if (affinity) {
+        show_affinity(thread_count);
+        compare_bindings(upper_bound, thread_count);
+        return EXIT_SUCCESS;
+    }
 
     // If num_threads is not specified, it will use the number of available cores as default. We can
     // also set the number of threads using the OMP_NUM_THREADS environment variable.
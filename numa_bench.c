@@ -0,0 +1,252 @@
+/*
+ * NUMA benchmark: serial vs parallel first-touch initialization of the bug_hunt array, for
+ * different thread bindings.
+ *
+ * The statistics pass of bug_hunt_solution.c reads a large array. If one thread initializes the
+ * whole array, all its pages land on that thread's NUMA node and every other socket reads them
+ * remotely (see placement.h). If the threads initialize it in parallel, with the same
+ * schedule(static) blocks as the statistics pass, every thread's pages are on its own node. This
+ * only helps as long as the threads stay on their nodes, which is what OMP_PROC_BIND and
+ * OMP_PLACES control:
+ *
+ *      OMP_PROC_BIND=false   -- threads may move between CPUs (and nodes) at any time
+ *      OMP_PROC_BIND=close   -- thread i is bound to a place next to thread i - 1
+ *      OMP_PROC_BIND=spread  -- threads are spread evenly over the places (and sockets)
+ *      OMP_PLACES=threads|cores|sockets -- what one place is
+ *
+ * The runtime reads these variables when it starts, so with --proc-bind and --places the program
+ * runs itself again for every combination; a variable without a list is left unset. The lists are
+ * separated by ';' (quote them in the shell), because a place list or a nested binding contains
+ * commas itself: --places 'cores;{0,1},{2,3}'. For every thread count and initialization it prints
+ * the time and throughput of the statistics pass (stats_compute()) and the fraction of sampled
+ * pages that are on the node of the thread that reads them.
+ *
+ * The array is allocated fresh for every run. Use sizes well above 32 MiB, so that malloc() gets
+ * new pages from the kernel instead of reusing pages that were already touched.
+ *
+ * Compile:
+ *  make numa_bench
+ * Run:     ./numa_bench [--threads LIST] [--size N] [--proc-bind LIST] [--places LIST]
+ *                       [--warmup N] [--trials N]
+ * Example: ./numa_bench --threads 8,16,32 --proc-bind 'false;close;spread' --places cores \
+ *                       > numa.csv
+ */
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "placement.h"
+#include "stats.h"
+#include "triangular.h"
+
+#define SAMPLED_PAGES 64 // per thread, for the local fraction
+
+typedef struct {
+    const unsigned long* data;
+    unsigned long n;
+    unsigned int thread_count;
+    stats result;
+} stats_run;
+
+static void run_stats(void* arg) {
+    stats_run* run = arg;
+    stats_compute(run->data, run->n, run->thread_count, &run->result);
+}
+
+// The same values as bug_hunt_solution.c (running totals of 1, 2, 3, ...), written by one thread.
+static void init_serial(unsigned long* array, unsigned long n) {
+    unsigned long total = 0;
+    for (unsigned long i = 0; i < n; i++) {
+        total += i + 1;
+        array[i] = total;
+    }
+}
+
+// The same values, written in parallel with the blocks of stats_compute(): first touch.
+static void init_first_touch(unsigned long* array, unsigned long n, unsigned int thread_count) {
+    unsigned long num_blocks = (n + STATS_BLOCK - 1) / STATS_BLOCK;
+
+#pragma omp parallel for num_threads(thread_count) schedule(static)
+    for (unsigned long b = 0; b < num_blocks; b++) {
+        unsigned long start = b * STATS_BLOCK;
+        unsigned long end = start + STATS_BLOCK < n ? start + STATS_BLOCK : n;
+        for (unsigned long i = start; i < end; i++) {
+            array[i] = triangular(i); // the running total of 1 .. i + 1 in closed form
+        }
+    }
+}
+
+// Run the benchmark for one thread count and one initialization. Returns 0 on success.
+static int run(unsigned long n, unsigned int thread_count, int first_touch,
+               const bench_config* config) {
+    unsigned long* array = malloc(n * sizeof(unsigned long));
+    placement_thread* threads = calloc(thread_count, sizeof(placement_thread));
+    if (array == NULL || threads == NULL) {
+        fprintf(stderr, "Cannot allocate %lu numbers\n", n);
+        return -1;
+    }
+
+    double start = omp_get_wtime();
+    if (first_touch) {
+        init_first_touch(array, n, thread_count);
+    } else {
+        init_serial(array, n);
+    }
+    double init_seconds = omp_get_wtime() - start;
+
+    stats_run stats_arg = { .data = array, .n = n, .thread_count = thread_count };
+    bench_result result;
+    bench_measure(config, run_stats, &stats_arg, &result);
+
+    // Where the threads of a team of this size run. With binding, the same places as above.
+    unsigned int team_size = thread_count;
+#pragma omp parallel num_threads(thread_count)
+    {
+        placement_record_thread(threads);
+#pragma omp single
+        team_size = omp_get_num_threads();
+    }
+    double local = placement_local_fraction(array, n, sizeof(unsigned long), STATS_BLOCK, threads,
+                                            team_size, SAMPLED_PAGES);
+
+    const char* proc_bind = getenv("OMP_PROC_BIND");
+    const char* places = getenv("OMP_PLACES");
+    double mib = n * sizeof(unsigned long) / (1024.0 * 1024.0);
+
+    // Quoted, because a place list or a nested binding contains commas.
+    printf("\"%s\",\"%s\",%u,%s,%lu,%.6f,%.9f,%.9f,%.9f,%.1f,", proc_bind ? proc_bind : "default",
+           places ? places : "default", thread_count, first_touch ? "first_touch" : "serial", n,
+           init_seconds, result.min, result.median, result.p95, mib / result.median);
+    if (local >= 0.0) {
+        printf("%.3f\n", local);
+    } else {
+        printf("n/a\n");
+    }
+    fflush(stdout);
+
+    int status = stats_arg.result.count == n ? 0 : -1;
+    free(threads);
+    free(array);
+    return status;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--threads LIST] [--size N] [--proc-bind LIST] [--places LIST] "
+            "[--warmup N] [--trials N]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads[BENCH_MAX_LIST];
+    int num_threads = bench_default_threads(threads, BENCH_MAX_LIST);
+    unsigned long n = 1UL << 24; // 128 MiB
+    char* proc_binds = NULL;
+    char* places = NULL;
+    int header = 1;
+    bench_config config = { .warmup = 1, .trials = 5 };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-header") == 0) {
+            header = 0;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(argv[i], "--threads") == 0) {
+            num_threads = bench_parse_list(argv[++i], threads, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--size") == 0) {
+            n = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--proc-bind") == 0) {
+            proc_binds = argv[++i];
+        } else if (strcmp(argv[i], "--places") == 0) {
+            places = argv[++i];
+        } else if (strcmp(argv[i], "--warmup") == 0) {
+            config.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--trials") == 0) {
+            config.trials = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (num_threads < 0 || n == 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (header) {
+        printf("proc_bind,places,threads,init,size,init_s,min_s,median_s,p95_s,mib_per_s,"
+               "local_pages\n");
+    }
+
+    if (proc_binds != NULL || places != NULL) {
+        // Run again for every combination, without --proc-bind/--places and without the header.
+        char** child_argv = malloc((argc + 2) * sizeof(char*));
+        int child_argc = 0;
+        for (int i = 0; i < argc; i++) {
+            if (strcmp(argv[i], "--proc-bind") == 0 || strcmp(argv[i], "--places") == 0) {
+                i++;
+            } else {
+                child_argv[child_argc++] = argv[i];
+            }
+        }
+        child_argv[child_argc++] = "--no-header";
+        child_argv[child_argc] = NULL;
+
+        // Copies, because strtok() cannot walk two lists at the same time. A missing list is one
+        // run with the variable unset (bind or place NULL).
+        char* bind_list = strdup(proc_binds != NULL ? proc_binds : "");
+        int status = EXIT_SUCCESS;
+        char* bind_save;
+        char* bind = strtok_r(bind_list, ";", &bind_save);
+        do {
+            char* place_list = strdup(places != NULL ? places : "");
+            char* place_save;
+            char* place = strtok_r(place_list, ";", &place_save);
+            do {
+                const char* names[2];
+                const char* values[2];
+                int num_env = 0;
+                if (bind != NULL) {
+                    names[num_env] = "OMP_PROC_BIND";
+                    values[num_env++] = bind;
+                }
+                if (place != NULL) {
+                    names[num_env] = "OMP_PLACES";
+                    values[num_env++] = place;
+                }
+                if (bench_run_self(child_argv, num_env, names, values) != 0) {
+                    fprintf(stderr, "Run with OMP_PROC_BIND=%s OMP_PLACES=%s failed\n",
+                            bind != NULL ? bind : "(default)", place != NULL ? place : "(default)");
+                    status = EXIT_FAILURE;
+                }
+                place = place != NULL ? strtok_r(NULL, ";", &place_save) : NULL;
+            } while (place != NULL);
+            free(place_list);
+            bind = bind != NULL ? strtok_r(NULL, ";", &bind_save) : NULL;
+        } while (bind != NULL);
+
+        free(bind_list);
+        free(child_argv);
+        return status;
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        for (int first_touch = 0; first_touch <= 1; first_touch++) {
+            if (run(n, threads[t], first_touch, &config) != 0) {
+                fprintf(stderr, "Incorrect result for %lu threads\n", threads[t]);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,342 @@
+/*
+ * OMPT tool that records a timeline of an OpenMP program and writes it as a Chrome/Perfetto trace.
+ *
+ * OMPT (OpenMP Tools Interface) lets a shared library register callbacks that the OpenMP runtime
+ * calls at interesting points: when a parallel region starts and ends, when a thread starts its
+ * part of a loop, when it gets the next chunk of iterations, when it waits in a barrier, and so on.
+ * The program itself does not change. The runtime loads the tool from OMP_TOOL_LIBRARIES:
+ *
+ *      OMP_TOOL_LIBRARIES=./libompt_trace.so ./scheduling 4 1000 --schedule dynamic,2
+ *
+ * and we can see which thread ran which iterations and when. This tool records:
+ *
+ *      parallel        -- parallel region, on the thread that starts it
+ *      implicit task   -- each thread's part of a parallel region
+ *      loop / single / sections / ... -- worksharing constructs, with their iteration count
+ *      chunk           -- a chunk of loop iterations handed to a thread (dispatch callback), from
+ *                         the moment it is handed out until the thread asks for the next one
+ *      barrier wait / taskwait / ... -- time spent waiting for other threads
+ *      reduction       -- time spent combining reduction variables
+ *
+ * Recording has to be cheap, or it changes the timing we want to see. Every thread appends to its
+ * own ring buffer (no locks, no shared cache lines); when a buffer is full, the oldest events are
+ * overwritten. The buffers are written out as JSON when the program ends. Open the file in
+ * chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Environment variables:
+ *      OMPT_TRACE_FILE    output file (default "ompt_trace.json")
+ *      OMPT_TRACE_EVENTS  events per thread buffer, rounded up to a power of 2 (default 65536)
+ *
+ * NOTE: OMPT is implemented by LLVM's OpenMP runtime (libomp), not by GCC's libgomp. Programs built
+ * with clang -fopenmp can use the tool directly. Programs built with gcc can be run on libomp,
+ * which also implements the GCC runtime interface:
+ *
+ *      LD_PRELOAD=/path/to/libomp.so OMP_TOOL_LIBRARIES=./libompt_trace.so ./parallel_for 4 1000
+ *
+ * Build (omp-tools.h comes with libomp):
+ *  make ompt_trace OMPT_CFLAGS=-I/usr/lib/llvm-14/lib/clang/14.0.6/include
+ */
+
+#include <omp-tools.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_TRACE_FILE "ompt_trace.json"
+#define DEFAULT_BUFFER_EVENTS 65536
+
+typedef enum {
+    EVENT_PARALLEL,
+    EVENT_IMPLICIT_TASK,
+    EVENT_WORK,
+    EVENT_CHUNK,
+    EVENT_SYNC_WAIT,
+    EVENT_REDUCTION,
+} event_type;
+
+typedef struct {
+    uint64_t time_ns;
+    uint64_t value; // iteration count, first iteration of a chunk, or team size
+    uint8_t type;   // event_type
+    uint8_t phase;  // 'B' (begin), 'E' (end) or 'C' (chunk dispatch)
+    uint16_t kind;  // ompt_work_t or ompt_sync_region_t
+} trace_event;
+
+typedef struct trace_buffer {
+    struct trace_buffer* next; // list of all buffers, for writing them out at the end
+    unsigned int thread_id;    // order in which threads first recorded an event
+    uint64_t count;            // events recorded so far (may exceed capacity)
+    trace_event events[];      // "capacity" events, used as a ring
+} trace_buffer;
+
+static trace_buffer* _Atomic all_buffers = NULL;
+static unsigned int _Atomic next_thread_id = 0;
+static uint64_t capacity = DEFAULT_BUFFER_EVENTS; // power of 2
+static uint64_t start_ns;
+
+// Each thread's own buffer. __thread makes one copy of this pointer per thread.
+static __thread trace_buffer* my_buffer = NULL;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Create this thread's buffer and add it to the list with a lock-free push.
+static trace_buffer* create_buffer(void) {
+    trace_buffer* buffer = calloc(1, sizeof(trace_buffer) + capacity * sizeof(trace_event));
+    if (buffer == NULL) {
+        return NULL;
+    }
+    buffer->thread_id = __atomic_fetch_add(&next_thread_id, 1, __ATOMIC_RELAXED);
+
+    trace_buffer* head = __atomic_load_n(&all_buffers, __ATOMIC_RELAXED);
+    do {
+        buffer->next = head;
+    } while (!__atomic_compare_exchange_n(&all_buffers, &head, buffer, 1, __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+    return buffer;
+}
+
+// The hot path: append one event to this thread's ring buffer. No locks, no shared writes.
+static void record(event_type type, char phase, unsigned int kind, uint64_t value) {
+    trace_buffer* buffer = my_buffer;
+    if (buffer == NULL) {
+        buffer = my_buffer = create_buffer();
+        if (buffer == NULL) {
+            return;
+        }
+    }
+
+    trace_event* event = &buffer->events[buffer->count & (capacity - 1)];
+    event->time_ns = now_ns();
+    event->value = value;
+    event->type = (uint8_t)type;
+    event->phase = (uint8_t)phase;
+    event->kind = (uint16_t)kind;
+    buffer->count++;
+}
+
+static char scope_phase(ompt_scope_endpoint_t endpoint) {
+    return endpoint == ompt_scope_begin ? 'B' : 'E';
+}
+
+static void on_parallel_begin(ompt_data_t* encountering_task_data,
+                              const ompt_frame_t* encountering_task_frame,
+                              ompt_data_t* parallel_data, unsigned int requested_parallelism,
+                              int flags, const void* codeptr_ra) {
+    (void)encountering_task_data, (void)encountering_task_frame, (void)parallel_data, (void)flags;
+    (void)codeptr_ra;
+    record(EVENT_PARALLEL, 'B', 0, requested_parallelism);
+}
+
+static void on_parallel_end(ompt_data_t* parallel_data, ompt_data_t* encountering_task_data,
+                            int flags, const void* codeptr_ra) {
+    (void)parallel_data, (void)encountering_task_data, (void)flags, (void)codeptr_ra;
+    record(EVENT_PARALLEL, 'E', 0, 0);
+}
+
+static void on_implicit_task(ompt_scope_endpoint_t endpoint, ompt_data_t* parallel_data,
+                             ompt_data_t* task_data, unsigned int actual_parallelism,
+                             unsigned int index, int flags) {
+    (void)parallel_data, (void)task_data, (void)index;
+    // The initial task of the program is also an implicit task; it is not part of a team.
+    if (flags & ompt_task_initial) {
+        return;
+    }
+    record(EVENT_IMPLICIT_TASK, scope_phase(endpoint), 0, actual_parallelism);
+}
+
+static void on_work(ompt_work_t wstype, ompt_scope_endpoint_t endpoint, ompt_data_t* parallel_data,
+                    ompt_data_t* task_data, uint64_t count, const void* codeptr_ra) {
+    (void)parallel_data, (void)task_data, (void)codeptr_ra;
+    record(EVENT_WORK, scope_phase(endpoint), wstype, count);
+}
+
+static void on_dispatch(ompt_data_t* parallel_data, ompt_data_t* task_data, ompt_dispatch_t kind,
+                        ompt_data_t instance) {
+    (void)parallel_data, (void)task_data;
+    if (kind == ompt_dispatch_iteration) {
+        record(EVENT_CHUNK, 'C', 0, instance.value);
+    }
+}
+
+static void on_sync_region_wait(ompt_sync_region_t kind, ompt_scope_endpoint_t endpoint,
+                                ompt_data_t* parallel_data, ompt_data_t* task_data,
+                                const void* codeptr_ra) {
+    (void)parallel_data, (void)task_data, (void)codeptr_ra;
+    record(EVENT_SYNC_WAIT, scope_phase(endpoint), kind, 0);
+}
+
+static void on_reduction(ompt_sync_region_t kind, ompt_scope_endpoint_t endpoint,
+                         ompt_data_t* parallel_data, ompt_data_t* task_data,
+                         const void* codeptr_ra) {
+    (void)kind, (void)parallel_data, (void)task_data, (void)codeptr_ra;
+    record(EVENT_REDUCTION, scope_phase(endpoint), 0, 0);
+}
+
+static const char* work_name(unsigned int kind) {
+    switch (kind) {
+    case ompt_work_loop:
+        return "loop";
+    case ompt_work_sections:
+        return "sections";
+    case ompt_work_single_executor:
+        return "single";
+    case ompt_work_single_other:
+        return "single (skipped)";
+    case ompt_work_workshare:
+        return "workshare";
+    case ompt_work_distribute:
+        return "distribute";
+    case ompt_work_taskloop:
+        return "taskloop";
+    default:
+        return "work";
+    }
+}
+
+static const char* sync_name(unsigned int kind) {
+    switch (kind) {
+    case ompt_sync_region_taskwait:
+        return "taskwait";
+    case ompt_sync_region_taskgroup:
+        return "taskgroup";
+    case ompt_sync_region_reduction:
+        return "reduction wait";
+    default:
+        return "barrier wait";
+    }
+}
+
+static void write_event(FILE* out, int* first, const char* name, char phase, uint64_t time_ns,
+                        unsigned int tid, const char* args_key, uint64_t args_value) {
+    fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u",
+            *first ? "" : ",", name, phase, (time_ns - start_ns) / 1000.0, tid);
+    if (args_key != NULL) {
+        fprintf(out, ",\"args\":{\"%s\":%lu}", args_key, (unsigned long)args_value);
+    }
+    fprintf(out, "}");
+    *first = 0;
+}
+
+static void write_buffer(FILE* out, int* first, const trace_buffer* buffer) {
+    uint64_t begin = buffer->count > capacity ? buffer->count - capacity : 0;
+    unsigned int tid = buffer->thread_id;
+
+    for (uint64_t i = begin; i < buffer->count; i++) {
+        const trace_event* e = &buffer->events[i & (capacity - 1)];
+
+        switch (e->type) {
+        case EVENT_PARALLEL:
+            write_event(out, first, "parallel", e->phase, e->time_ns, tid,
+                        e->phase == 'B' ? "requested_threads" : NULL, e->value);
+            break;
+        case EVENT_IMPLICIT_TASK:
+            write_event(out, first, "implicit task", e->phase, e->time_ns, tid,
+                        e->phase == 'B' ? "team_size" : NULL, e->value);
+            break;
+        case EVENT_WORK:
+            write_event(out, first, work_name(e->kind), e->phase, e->time_ns, tid,
+                        e->phase == 'B' ? "iterations" : NULL, e->value);
+            break;
+        case EVENT_SYNC_WAIT:
+            write_event(out, first, sync_name(e->kind), e->phase, e->time_ns, tid, NULL, 0);
+            break;
+        case EVENT_REDUCTION:
+            write_event(out, first, "reduction", e->phase, e->time_ns, tid, NULL, 0);
+            break;
+        case EVENT_CHUNK: {
+            // A chunk runs until the thread's next event (the next dispatch or the end of the
+            // loop), so it becomes one complete ("X") event with a duration.
+            uint64_t end_ns = i + 1 < buffer->count
+                                  ? buffer->events[(i + 1) & (capacity - 1)].time_ns
+                                  : e->time_ns;
+            fprintf(out,
+                    "%s\n{\"name\":\"chunk\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,"
+                    "\"tid\":%u,\"args\":{\"first_iteration\":%lu}}",
+                    *first ? "" : ",", (e->time_ns - start_ns) / 1000.0,
+                    (end_ns - e->time_ns) / 1000.0, tid, (unsigned long)e->value);
+            *first = 0;
+            break;
+        }
+        }
+    }
+}
+
+static int tool_initialize(ompt_function_lookup_t lookup, int initial_device_num,
+                           ompt_data_t* tool_data) {
+    (void)initial_device_num, (void)tool_data;
+
+    const char* events = getenv("OMPT_TRACE_EVENTS");
+    if (events != NULL && atol(events) > 0) {
+        capacity = 1;
+        while (capacity < (uint64_t)atol(events)) {
+            capacity *= 2;
+        }
+    }
+    start_ns = now_ns();
+
+    ompt_set_callback_t set_callback = (ompt_set_callback_t)lookup("ompt_set_callback");
+    if (set_callback == NULL) {
+        return 0; // returning 0 disables the tool
+    }
+
+    // A runtime may not support every callback; the others still work.
+    set_callback(ompt_callback_parallel_begin, (ompt_callback_t)on_parallel_begin);
+    set_callback(ompt_callback_parallel_end, (ompt_callback_t)on_parallel_end);
+    set_callback(ompt_callback_implicit_task, (ompt_callback_t)on_implicit_task);
+    set_callback(ompt_callback_work, (ompt_callback_t)on_work);
+    set_callback(ompt_callback_sync_region_wait, (ompt_callback_t)on_sync_region_wait);
+    set_callback(ompt_callback_reduction, (ompt_callback_t)on_reduction);
+    if (set_callback(ompt_callback_dispatch, (ompt_callback_t)on_dispatch) == ompt_set_never) {
+        fprintf(stderr, "ompt_trace: this runtime does not report chunk dispatch\n");
+    }
+
+    return 1;
+}
+
+static void tool_finalize(ompt_data_t* tool_data) {
+    (void)tool_data;
+
+    const char* path = getenv("OMPT_TRACE_FILE");
+    if (path == NULL) {
+        path = DEFAULT_TRACE_FILE;
+    }
+
+    FILE* out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        return;
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    int first = 1;
+    uint64_t dropped = 0;
+    for (trace_buffer* b = __atomic_load_n(&all_buffers, __ATOMIC_ACQUIRE); b != NULL;
+         b = b->next) {
+        write_buffer(out, &first, b);
+        if (b->count > capacity) {
+            dropped += b->count - capacity;
+        }
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+
+    fprintf(stderr, "ompt_trace: wrote %s", path);
+    if (dropped > 0) {
+        fprintf(stderr, " (%lu oldest events overwritten, raise OMPT_TRACE_EVENTS)",
+                (unsigned long)dropped);
+    }
+    fprintf(stderr, "\n");
+}
+
+// The runtime looks for this function in every library listed in OMP_TOOL_LIBRARIES.
+ompt_start_tool_result_t* ompt_start_tool(unsigned int omp_version, const char* runtime_version) {
+    (void)omp_version, (void)runtime_version;
+    static ompt_start_tool_result_t result = { tool_initialize, tool_finalize, { 0 } };
+    return &result;
+}
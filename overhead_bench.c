@@ -0,0 +1,359 @@
+/*
+ * Overhead of the OpenMP constructs: what does one "#pragma omp ..." cost?
+ *
+ * intro.c opens one parallel region and mentions barrier. Every construct has a price: a parallel
+ * region wakes up (or creates) the team and joins it again, a barrier makes every thread wait for
+ * the slowest one, a critical section is a lock, and so on. Programs that open thousands of short
+ * regions per second pay it thousands of times per second. This program measures the cost of one
+ * invocation in microseconds, with the method of the EPCC OpenMP microbenchmarks (J. M. Bull,
+ * "Measuring synchronisation and scheduling overheads in OpenMP", EWOMP 1999):
+ *
+ *      reference -- run delay() "innerreps" times on one thread
+ *      test      -- run the construct "innerreps" times, with delay() inside it (so the construct
+ *                   does the same amount of work as the reference)
+ *      overhead  -- (test time - reference time) / innerreps
+ *
+ * delay() is a short busy loop (0.1 us by default, see --delay-us) that keeps the construct from
+ * being optimized into nothing. innerreps is doubled until a test takes at least --target-ms, so
+ * that the timer resolution does not matter, and then the test is repeated --trials times.
+ *
+ *      parallel      -- #pragma omp parallel { delay }
+ *      for           -- #pragma omp for over thread_count iterations of delay, inside one region
+ *      parallel_for  -- #pragma omp parallel for over thread_count iterations of delay
+ *      barrier       -- delay; #pragma omp barrier
+ *      single        -- #pragma omp single { delay }
+ *      master        -- #pragma omp masked { delay } (master with compilers that lack masked)
+ *      critical      -- #pragma omp critical { delay }, innerreps / thread_count per thread, so
+ *                       that the total number of delays is innerreps
+ *      atomic        -- #pragma omp atomic x += 1, innerreps / thread_count per thread; the
+ *                       reference is x += 1 on one thread
+ *      reduction     -- #pragma omp parallel reduction(+ : x) { delay; x += 1 }
+ *
+ * OMP_WAIT_POLICY tells idle threads to spin (active) or to sleep (passive) while they wait. It is
+ * read once when the program starts, so --wait-policies runs this program again for every policy.
+ *
+ * Compile:
+ *  make overhead_bench
+ * Run:     ./overhead_bench [--threads LIST] [--wait-policies LIST] [--delay-us X] [--target-ms X]
+ *                          [--trials N]
+ * Example: ./overhead_bench --threads 1,2,4,8 --wait-policies active,passive > overhead.csv
+ */
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "workload.h"
+
+static unsigned int thread_count;
+static unsigned long delay_units;
+
+// Busy wait of about --delay-us microseconds. xorshift never returns 0, but the compiler cannot
+// know that, so the work is always done.
+static void delay(void) {
+    if (workload_spin(delay_units, 1) == 0) {
+        abort();
+    }
+}
+
+static void reference_delay(unsigned long innerreps) {
+    for (unsigned long j = 0; j < innerreps; j++) {
+        delay();
+    }
+}
+
+static void reference_atomic(unsigned long innerreps) {
+    // volatile, or the compiler would replace the loop by x = innerreps
+    volatile unsigned long x = 0;
+    for (unsigned long j = 0; j < innerreps; j++) {
+        x += 1;
+    }
+}
+
+static void test_parallel(unsigned long innerreps) {
+    for (unsigned long j = 0; j < innerreps; j++) {
+#pragma omp parallel num_threads(thread_count)
+        delay();
+    }
+}
+
+static void test_for(unsigned long innerreps) {
+#pragma omp parallel num_threads(thread_count)
+    for (unsigned long j = 0; j < innerreps; j++) {
+#pragma omp for
+        for (unsigned int i = 0; i < thread_count; i++) {
+            delay();
+        }
+    }
+}
+
+static void test_parallel_for(unsigned long innerreps) {
+    for (unsigned long j = 0; j < innerreps; j++) {
+#pragma omp parallel for num_threads(thread_count)
+        for (unsigned int i = 0; i < thread_count; i++) {
+            delay();
+        }
+    }
+}
+
+static void test_barrier(unsigned long innerreps) {
+#pragma omp parallel num_threads(thread_count)
+    for (unsigned long j = 0; j < innerreps; j++) {
+        delay();
+#pragma omp barrier
+    }
+}
+
+static void test_single(unsigned long innerreps) {
+#pragma omp parallel num_threads(thread_count)
+    for (unsigned long j = 0; j < innerreps; j++) {
+#pragma omp single
+        delay();
+    }
+}
+
+static void test_master(unsigned long innerreps) {
+#pragma omp parallel num_threads(thread_count)
+    for (unsigned long j = 0; j < innerreps; j++) {
+        // masked (OpenMP 5.1) replaces master. The other threads skip the block without waiting.
+#if _OPENMP >= 202011
+#pragma omp masked
+#else
+#pragma omp master
+#endif
+        delay();
+    }
+}
+
+static void test_critical(unsigned long innerreps) {
+#pragma omp parallel num_threads(thread_count)
+    for (unsigned long j = 0; j < innerreps / thread_count; j++) {
+#pragma omp critical
+        delay();
+    }
+}
+
+static void test_atomic(unsigned long innerreps) {
+    unsigned long x = 0;
+
+#pragma omp parallel num_threads(thread_count)
+    for (unsigned long j = 0; j < innerreps / thread_count; j++) {
+#pragma omp atomic
+        x += 1;
+    }
+
+    if (x != innerreps / thread_count * thread_count) {
+        abort();
+    }
+}
+
+static void test_reduction(unsigned long innerreps) {
+    unsigned long x = 0;
+
+    for (unsigned long j = 0; j < innerreps; j++) {
+#pragma omp parallel num_threads(thread_count) reduction(+ : x)
+        {
+            delay();
+            x += 1;
+        }
+    }
+
+    if (x < innerreps) {
+        abort();
+    }
+}
+
+typedef void (*construct_fn)(unsigned long innerreps);
+
+static const struct {
+    const char* name;
+    construct_fn test;
+    construct_fn reference;
+} constructs[] = {
+    { "parallel", test_parallel, reference_delay },
+    { "for", test_for, reference_delay },
+    { "parallel_for", test_parallel_for, reference_delay },
+    { "barrier", test_barrier, reference_delay },
+    { "single", test_single, reference_delay },
+    { "master", test_master, reference_delay },
+    { "critical", test_critical, reference_delay },
+    { "atomic", test_atomic, reference_atomic },
+    { "reduction", test_reduction, reference_delay },
+};
+
+static const unsigned int num_constructs = sizeof(constructs) / sizeof(constructs[0]);
+
+static double time_once(construct_fn fn, unsigned long innerreps) {
+    double start = omp_get_wtime();
+    fn(innerreps);
+    return omp_get_wtime() - start;
+}
+
+// Number of work units that delay() needs to take delay_us microseconds.
+static unsigned long calibrate_delay(double delay_us) {
+    const unsigned long units = 1000000;
+    double seconds = 0.0;
+
+    // Best of a few runs, in case the first one also pays for page faults or a frequency change.
+    for (int run = 0; run < 5; run++) {
+        double start = omp_get_wtime();
+        if (workload_spin(units, 1) == 0) {
+            abort();
+        }
+        double elapsed = omp_get_wtime() - start;
+        if (run == 0 || elapsed < seconds) {
+            seconds = elapsed;
+        }
+    }
+
+    double units_per_us = units / (seconds * 1e6);
+    unsigned long result = (unsigned long)(delay_us * units_per_us + 0.5);
+    return result > 0 ? result : 1;
+}
+
+static void measure(unsigned int c, double target_seconds, unsigned int trials,
+                    const char* wait_policy, double delay_us) {
+    // Double innerreps until the test takes long enough to time reliably.
+    unsigned long innerreps = thread_count;
+    while (time_once(constructs[c].test, innerreps) < target_seconds && innerreps < (1UL << 40)) {
+        innerreps *= 2;
+    }
+
+    // The reference is the same for every trial, so take its best time.
+    double reference = 0.0;
+    for (unsigned int t = 0; t < trials; t++) {
+        double seconds = time_once(constructs[c].reference, innerreps);
+        if (t == 0 || seconds < reference) {
+            reference = seconds;
+        }
+    }
+
+    double* overheads = malloc(trials * sizeof(double));
+    for (unsigned int t = 0; t < trials; t++) {
+        overheads[t] = (time_once(constructs[c].test, innerreps) - reference) / innerreps * 1e6;
+    }
+
+    bench_result result;
+    bench_summarize(overheads, trials, &result);
+    free(overheads);
+
+    printf("%s,%u,%s,%.3f,%lu,%.6f,%.6f,%.6f,%.6f\n", constructs[c].name, thread_count,
+           wait_policy, delay_us, innerreps, reference / innerreps * 1e6, result.min,
+           result.median, result.p95);
+    fflush(stdout);
+}
+
+// Run this program again once per wait policy, with OMP_WAIT_POLICY set and without the
+// --wait-policies option. The runtime reads OMP_WAIT_POLICY when it starts, so every policy needs
+// a new process.
+static int run_wait_policies(int argc, char** argv, char* policies) {
+    char** child_argv = malloc((argc + 2) * sizeof(char*));
+    int child_argc = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--wait-policies") == 0) {
+            i++; // skip its value too
+        } else {
+            child_argv[child_argc++] = argv[i];
+        }
+    }
+    child_argv[child_argc++] = "--no-header";
+    child_argv[child_argc] = NULL;
+
+    int status = EXIT_SUCCESS;
+    const char* name = "OMP_WAIT_POLICY";
+
+    for (char* policy = strtok(policies, ","); policy != NULL; policy = strtok(NULL, ",")) {
+        const char* value = policy;
+        if (bench_run_self(child_argv, 1, &name, &value) != 0) {
+            fprintf(stderr, "Run with OMP_WAIT_POLICY=%s failed\n", policy);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    free(child_argv);
+    return status;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--threads LIST] [--wait-policies LIST] [--delay-us X] [--target-ms X] "
+            "[--trials N]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads[BENCH_MAX_LIST];
+    int num_threads = -1; // default set below, after the wait policies are handled
+    char* wait_policies = NULL;
+    int header = 1;
+    double delay_us = 0.1;
+    double target_ms = 1.0;
+    unsigned int trials = 20;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-header") == 0) {
+            header = 0;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(argv[i], "--threads") == 0) {
+            num_threads = bench_parse_list(argv[++i], threads, BENCH_MAX_LIST, 1);
+            if (num_threads < 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--wait-policies") == 0) {
+            wait_policies = argv[++i];
+        } else if (strcmp(argv[i], "--delay-us") == 0) {
+            delay_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--target-ms") == 0) {
+            target_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--trials") == 0) {
+            trials = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (delay_us <= 0.0 || target_ms <= 0.0 || trials < 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (header) {
+        printf("construct,threads,wait_policy,delay_us,innerreps,reference_us,min_us,median_us,"
+               "p95_us\n");
+    }
+
+    if (wait_policies != NULL) {
+        return run_wait_policies(argc, argv, wait_policies);
+    }
+
+    if (num_threads < 0) {
+        num_threads = bench_default_threads(threads, BENCH_MAX_LIST);
+    }
+
+    const char* wait_policy = getenv("OMP_WAIT_POLICY");
+    if (wait_policy == NULL) {
+        wait_policy = "default";
+    }
+
+    delay_units = calibrate_delay(delay_us);
+
+    for (int t = 0; t < num_threads; t++) {
+        thread_count = threads[t];
+        for (unsigned int c = 0; c < num_constructs; c++) {
+            measure(c, target_ms / 1000.0, trials, wait_policy, delay_us);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+/*
+ * Generic parallel reductions for C++: parallel_reduce<T, Op, Schedule> and
+ * parallel_transform_reduce<T, Op, Schedule>.
+ *
+ * scope.c, reduction.c, parallel_for.c, scheduling.c and bug_hunt_solution.c all write the same
+ * reduction by hand, for one element type (unsigned long) and one operator each. The pragmas only
+ * accept a fixed set of operators, and the schedule is part of the pragma text. In C++ all three
+ * can be template parameters instead:
+ *
+ *      T         -- the type of the result, e.g. unsigned long, double or a struct
+ *      Op        -- a type with "static T identity()" and "static T combine(T, T)"; combine must be
+ *                   associative (and commutative, since the threads may finish in any order)
+ *      Schedule  -- static_schedule, dynamic_schedule<Chunk>, guided_schedule<Chunk> or
+ *                   runtime_schedule
+ *
+ * Everything is known at compile time, so each instantiation is one OpenMP loop specialized for
+ * its type, operator and schedule: the compiler inlines Op::combine and the transform into the
+ * loop and can vectorize it exactly like the hand-written pragma. The reduction itself is a
+ * user-defined reduction ("omp declare reduction", see stats.h), so the runtime combines the
+ * per-thread results the same way it combines reduction(+ : sum).
+ *
+ *      // sum of 1 .. upper_bound, like parallel_for.c
+ *      unsigned long sum = parallel_transform_reduce<unsigned long>(
+ *          1UL, upper_bound + 1, [](unsigned long i) { return i; }, thread_count);
+ *
+ *      // largest element of an array, with schedule(dynamic, 4096)
+ *      unsigned long largest = parallel_reduce<unsigned long, max_op<unsigned long>,
+ *                                              dynamic_schedule<4096>>(data, n, thread_count);
+ *
+ * Compile with -fopenmp and at least -O2 (C++17 or later).
+ */
+
+#ifndef PARALLEL_REDUCE_HPP
+#define PARALLEL_REDUCE_HPP
+
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#include <omp.h>
+
+namespace omp_tutorial {
+
+// Schedules. Chunk < 1 means the default chunk size of the kind.
+struct static_schedule { };
+
+template <int Chunk = 0> struct dynamic_schedule {
+    static constexpr int chunk = Chunk;
+};
+
+template <int Chunk = 0> struct guided_schedule {
+    static constexpr int chunk = Chunk;
+};
+
+// schedule(runtime): whatever omp_set_schedule() or OMP_SCHEDULE selected.
+struct runtime_schedule { };
+
+// Operators.
+template <typename T> struct plus_op {
+    static T identity() {
+        return T(0);
+    }
+    static T combine(T a, T b) {
+        return a + b;
+    }
+};
+
+template <typename T> struct min_op {
+    static T identity() {
+        return std::numeric_limits<T>::max();
+    }
+    static T combine(T a, T b) {
+        return b < a ? b : a;
+    }
+};
+
+template <typename T> struct max_op {
+    static T identity() {
+        return std::numeric_limits<T>::lowest();
+    }
+    static T combine(T a, T b) {
+        return a < b ? b : a;
+    }
+};
+
+// Op::combine(..., transform(i)) over i in [first, last), on thread_count threads.
+template <typename T, typename Op = plus_op<T>, typename Schedule = static_schedule,
+          typename Index, typename Transform>
+T parallel_transform_reduce(Index first, Index last, Transform transform,
+                            unsigned int thread_count) {
+    static_assert(std::is_integral<Index>::value, "the loop index must be an integer");
+
+    // A reduction for this operator: every thread starts from Op::identity(), and the runtime
+    // merges the private results with Op::combine().
+#pragma omp declare reduction(op_reduce:T : omp_out = Op::combine(omp_out, omp_in))              \
+    initializer(omp_priv = Op::identity())
+
+    T result = Op::identity();
+
+    // The schedule kind is part of the pragma text, so every kind needs its own loop. Only the
+    // branch for Schedule is compiled.
+    if constexpr (std::is_same<Schedule, static_schedule>::value) {
+#pragma omp parallel for num_threads(thread_count) schedule(static) reduction(op_reduce : result)
+        for (Index i = first; i < last; i++) {
+            result = Op::combine(result, transform(i));
+        }
+    } else if constexpr (std::is_same<Schedule, runtime_schedule>::value) {
+#pragma omp parallel for num_threads(thread_count) schedule(runtime) reduction(op_reduce : result)
+        for (Index i = first; i < last; i++) {
+            result = Op::combine(result, transform(i));
+        }
+    } else if constexpr (std::is_same<Schedule, dynamic_schedule<Schedule::chunk>>::value) {
+        if constexpr (Schedule::chunk > 0) {
+#pragma omp parallel for num_threads(thread_count) schedule(dynamic, Schedule::chunk)             \
+    reduction(op_reduce : result)
+            for (Index i = first; i < last; i++) {
+                result = Op::combine(result, transform(i));
+            }
+        } else {
+#pragma omp parallel for num_threads(thread_count) schedule(dynamic) reduction(op_reduce : result)
+            for (Index i = first; i < last; i++) {
+                result = Op::combine(result, transform(i));
+            }
+        }
+    } else {
+        static_assert(std::is_same<Schedule, guided_schedule<Schedule::chunk>>::value,
+                      "unknown schedule");
+        if constexpr (Schedule::chunk > 0) {
+#pragma omp parallel for num_threads(thread_count) schedule(guided, Schedule::chunk)              \
+    reduction(op_reduce : result)
+            for (Index i = first; i < last; i++) {
+                result = Op::combine(result, transform(i));
+            }
+        } else {
+#pragma omp parallel for num_threads(thread_count) schedule(guided) reduction(op_reduce : result)
+            for (Index i = first; i < last; i++) {
+                result = Op::combine(result, transform(i));
+            }
+        }
+    }
+
+    return result;
+}
+
+// Op::combine(..., data[i]) over the n elements of data.
+template <typename T, typename Op = plus_op<T>, typename Schedule = static_schedule>
+T parallel_reduce(const T* data, std::size_t n, unsigned int thread_count) {
+    return parallel_transform_reduce<T, Op, Schedule>(
+        std::size_t(0), n, [data](std::size_t i) { return data[i]; }, thread_count);
+}
+
+} // namespace omp_tutorial
+
+#endif
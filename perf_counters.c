@@ -0,0 +1,213 @@
+/*
+ * Per-thread hardware performance counters. See perf_counters.h.
+ */
+
+#include "perf_counters.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const struct {
+    unsigned int type;
+    unsigned long config;
+} events[PERF_NUM_EVENTS] = {
+    [PERF_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    [PERF_INSTRUCTIONS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    // "Cache misses" is the last-level cache on most processors.
+    [PERF_LLC_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    [PERF_BRANCH_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    // Generic cache events are encoded as cache | (operation << 8) | (result << 16).
+    [PERF_DTLB_MISSES] = { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB
+                                                   | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                                   | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+};
+
+// glibc has no wrapper for perf_event_open, so we call the system call directly.
+static int open_counter(unsigned int type, unsigned long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    // Count user space only: that is our code, and it is allowed at perf_event_paranoid = 2.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // If there are more events than hardware counters, the kernel time-shares the counters. These
+    // times let us scale the counts up to the full interval.
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // pid = 0, cpu = -1: the calling thread, on whatever CPU it runs.
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Read a counter, scaled for time-sharing. Returns -1 if it cannot be read or never ran.
+static int read_counter(int fd, unsigned long* value) {
+    unsigned long data[3]; // value, time enabled, time running
+    if (read(fd, data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+        return -1;
+    }
+
+    *value = data[0];
+    if (data[2] < data[1]) {
+        *value = (unsigned long)((double)data[0] * data[1] / data[2]);
+    }
+    return 0;
+}
+
+void perf_region_init(perf_region* region, unsigned int max_threads) {
+    region->max_threads = max_threads;
+    region->threads = calloc(max_threads, sizeof(perf_thread_counts));
+    region->open_error = 0;
+}
+
+void perf_region_free(perf_region* region) {
+    free(region->threads);
+    region->threads = NULL;
+}
+
+void perf_thread_begin(perf_region* region, perf_thread_state* state) {
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        state->fds[e] = open_counter(events[e].type, events[e].config);
+        if (state->fds[e] < 0) {
+#pragma omp atomic write
+            region->open_error = errno;
+        }
+    }
+
+    // Start all counters as close together as possible, after the (slow) opening is done.
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        if (state->fds[e] >= 0) {
+            ioctl(state->fds[e], PERF_EVENT_IOC_RESET, 0);
+            ioctl(state->fds[e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    state->start = omp_get_wtime();
+}
+
+void perf_thread_end(perf_region* region, perf_thread_state* state) {
+    double seconds = omp_get_wtime() - state->start;
+
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        if (state->fds[e] >= 0) {
+            ioctl(state->fds[e], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    // Each thread writes only its own entry, so no synchronization is needed. A thread beyond
+    // max_threads has no entry, but still closes its counters.
+    unsigned int tid = omp_get_thread_num();
+    perf_thread_counts* counts = tid < region->max_threads ? &region->threads[tid] : NULL;
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        if (counts != NULL) {
+            counts->valid[e] = 0;
+        }
+        if (state->fds[e] >= 0) {
+            if (counts != NULL) {
+                counts->valid[e] = read_counter(state->fds[e], &counts->values[e]) == 0;
+            }
+            close(state->fds[e]);
+        }
+    }
+    if (counts != NULL) {
+        counts->seconds = seconds;
+        counts->used = 1;
+    }
+}
+
+// Print "value" or "n/a" in a column of the given width.
+static void print_count(int valid, unsigned long value, int width) {
+    if (valid) {
+        printf(" %*lu", width, value);
+    } else {
+        printf(" %*s", width, "n/a");
+    }
+}
+
+// Print a ratio (scaled by "scale") or "n/a" if either count is missing or the divisor is 0.
+static void print_ratio(int valid, unsigned long numerator, unsigned long denominator,
+                        double scale, int width) {
+    if (valid && denominator > 0) {
+        printf(" %*.3f", width, scale * numerator / denominator);
+    } else {
+        printf(" %*s", width, "n/a");
+    }
+}
+
+static void print_row(const char* label, const perf_thread_counts* c) {
+    printf("%-8s %10.6f", label, c->seconds);
+    print_count(c->valid[PERF_CYCLES], c->values[PERF_CYCLES], 14);
+    print_count(c->valid[PERF_INSTRUCTIONS], c->values[PERF_INSTRUCTIONS], 14);
+    print_ratio(c->valid[PERF_INSTRUCTIONS] && c->valid[PERF_CYCLES],
+                c->values[PERF_INSTRUCTIONS], c->values[PERF_CYCLES], 1.0, 6);
+    print_count(c->valid[PERF_LLC_MISSES], c->values[PERF_LLC_MISSES], 12);
+    print_ratio(c->valid[PERF_LLC_MISSES] && c->valid[PERF_INSTRUCTIONS],
+                c->values[PERF_LLC_MISSES], c->values[PERF_INSTRUCTIONS], 1000.0, 10);
+    print_count(c->valid[PERF_BRANCH_MISSES], c->values[PERF_BRANCH_MISSES], 12);
+    print_ratio(c->valid[PERF_BRANCH_MISSES] && c->valid[PERF_INSTRUCTIONS],
+                c->values[PERF_BRANCH_MISSES], c->values[PERF_INSTRUCTIONS], 1000.0, 10);
+    print_count(c->valid[PERF_DTLB_MISSES], c->values[PERF_DTLB_MISSES], 12);
+    print_ratio(c->valid[PERF_DTLB_MISSES] && c->valid[PERF_INSTRUCTIONS],
+                c->values[PERF_DTLB_MISSES], c->values[PERF_INSTRUCTIONS], 1000.0, 10);
+    printf("\n");
+}
+
+void perf_region_total(const perf_region* region, perf_thread_counts* total) {
+    memset(total, 0, sizeof(*total));
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        total->valid[e] = 1;
+    }
+
+    for (unsigned int t = 0; t < region->max_threads; t++) {
+        const perf_thread_counts* c = &region->threads[t];
+        if (!c->used) {
+            continue;
+        }
+
+        // The total is only valid if the counter worked on every thread.
+        for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+            total->values[e] += c->values[e];
+            total->valid[e] = total->valid[e] && c->valid[e];
+        }
+        if (c->seconds > total->seconds) {
+            total->seconds = c->seconds; // the slowest thread, for comparison with the wall time
+        }
+        total->used = 1;
+    }
+}
+
+void perf_region_report(const perf_region* region, double wall_seconds) {
+    printf("%-8s %10s %14s %14s %6s %12s %10s %12s %10s %12s %10s\n", "thread", "time_s",
+           "cycles", "instructions", "IPC", "LLC_misses", "LLC_MPKI", "br_misses", "br_MPKI",
+           "dTLB_misses", "dTLB_MPKI");
+
+    for (unsigned int t = 0; t < region->max_threads; t++) {
+        const perf_thread_counts* c = &region->threads[t];
+        if (!c->used) {
+            continue;
+        }
+
+        char label[16];
+        snprintf(label, sizeof(label), "%u", t);
+        print_row(label, c);
+    }
+
+    perf_thread_counts total;
+    perf_region_total(region, &total);
+    print_row("total", &total);
+    printf("Wall time: %.6f s (MPKI = misses per 1000 instructions)\n", wall_seconds);
+
+    if (region->open_error != 0) {
+        printf("Note: some hardware counters are not available (perf_event_open: %s). Check "
+               "/proc/sys/kernel/perf_event_paranoid.\n",
+               strerror(region->open_error));
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * Per-thread hardware performance counters for OpenMP parallel regions (Linux perf_event_open).
+ *
+ * When a parallel loop scales badly, the wall time alone does not say why. Hardware counters help:
+ *
+ *      IPC (instructions per cycle) -- low IPC means the core is mostly waiting, usually for memory
+ *      LLC misses per 1000 instructions -- high means the loop is limited by memory bandwidth
+ *      branch misses per 1000 instructions -- high means the core keeps throwing work away
+ *      dTLB misses per 1000 instructions -- high means address translation is expensive: the data
+ *          is spread over more pages than the TLB can cover (huge pages help, see arena.h)
+ *      per-thread cycles -- very different values between threads mean load imbalance
+ *
+ * Every thread opens its own counters when it enters the region and reads them before it leaves,
+ * so each thread counts only its own work:
+ *
+ *      perf_region region;
+ *      perf_region_init(&region, thread_count);
+ *      #pragma omp parallel num_threads(thread_count)
+ *      {
+ *          perf_thread_state state;
+ *          perf_thread_begin(&region, &state);
+ *          ... work ...
+ *          perf_thread_end(&region, &state);
+ *      }
+ *      perf_region_report(&region, wall_seconds);
+ *      perf_region_free(&region);
+ *
+ * Access to hardware counters is often restricted (kernel.perf_event_paranoid, containers, virtual
+ * machines without a virtual PMU). Counters that cannot be opened are reported as "n/a", and the
+ * program keeps running normally.
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_NUM_EVENTS
+};
+
+// Counts of one thread. valid[e] is 0 if counter e could not be opened or read.
+typedef struct {
+    unsigned long values[PERF_NUM_EVENTS];
+    int valid[PERF_NUM_EVENTS];
+    double seconds;
+    int used; // 1 if this thread ran perf_thread_end()
+} perf_thread_counts;
+
+typedef struct {
+    unsigned int max_threads;
+    perf_thread_counts* threads; // indexed by thread number
+    int open_error;              // errno of a failed perf_event_open(), 0 if none failed
+} perf_region;
+
+// What a thread needs between perf_thread_begin() and perf_thread_end(). Keep it on the stack.
+typedef struct {
+    int fds[PERF_NUM_EVENTS];
+    double start;
+} perf_thread_state;
+
+void perf_region_init(perf_region* region, unsigned int max_threads);
+
+void perf_region_free(perf_region* region);
+
+// Open and start this thread's counters. Call inside the parallel region.
+void perf_thread_begin(perf_region* region, perf_thread_state* state);
+
+// Stop and read this thread's counters into region->threads[omp_get_thread_num()].
+void perf_thread_end(perf_region* region, perf_thread_state* state);
+
+// Sum the counts of all threads into *total. total->seconds is the time of the slowest thread, and
+// total->valid[e] is 1 only if counter e worked on every thread.
+void perf_region_total(const perf_region* region, perf_thread_counts* total);
+
+// Print a table with time, cycles, instructions, IPC and miss rates per thread and in total.
+void perf_region_report(const perf_region* region, double wall_seconds);
+
+#endif
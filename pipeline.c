@@ -0,0 +1,131 @@
+/*
+ * Task-dependency pipeline that generates, summarizes and writes the series. See pipeline.h.
+ */
+
+#include "pipeline.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "series_file.h"
+#include "triangular.h"
+
+// pwrite() may write less than asked for, so keep going until everything is written.
+static int write_all(int fd, const void* data, unsigned long size, unsigned long offset) {
+    const char* p = data;
+    while (size > 0) {
+        ssize_t written = pwrite(fd, p, size, offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += written;
+        size -= written;
+        offset += written;
+    }
+    return 0;
+}
+
+static void generate_chunk(unsigned long* buffer, unsigned long start, unsigned long count) {
+    unsigned long value = triangular(start);
+    for (unsigned long k = 0; k < count; k++) {
+        buffer[k] = value;
+        value += start + k + 2; // T(i + 1) = T(i) + (i + 2)
+    }
+}
+
+int pipeline_run(const char* path, unsigned long n, unsigned int thread_count, stats* result) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+
+    unsigned long num_chunks = (n + PIPELINE_CHUNK - 1) / PIPELINE_CHUNK;
+    unsigned long num_slots = PIPELINE_SLOTS_PER_THREAD * thread_count;
+    unsigned long* buffers = malloc(num_slots * PIPELINE_CHUNK * sizeof(unsigned long));
+    stats* slot_stats = malloc(num_slots * sizeof(stats));
+    // Only the addresses of these matter: they name the slots in the depend clauses.
+    char* slot_tokens = malloc(num_slots);
+    int write_error = 0; // errno of the first failed write, 0 if all writes succeeded
+
+    for (unsigned long s = 0; s < num_slots; s++) {
+        stats_init(&slot_stats[s]);
+    }
+
+#pragma omp parallel num_threads(thread_count)
+#pragma omp single
+    {
+        // One thread creates all tasks; every thread in the team (including this one, when it is
+        // done creating tasks) runs them.
+        for (unsigned long k = 0; k < num_chunks; k++) {
+            unsigned long s = k % num_slots;
+            unsigned long* buffer = buffers + s * PIPELINE_CHUNK;
+            unsigned long start = k * PIPELINE_CHUNK;
+            unsigned long count = n - start < PIPELINE_CHUNK ? n - start : PIPELINE_CHUNK;
+
+#pragma omp task depend(inout : slot_tokens[s]) firstprivate(buffer, start, count)
+            generate_chunk(buffer, start, count);
+
+            // Chunks that share a slot are processed one after another (generate k + num_slots
+            // waits for stats k), so slot_stats[s] is never updated by two tasks at once.
+#pragma omp task depend(in : slot_tokens[s]) firstprivate(buffer, count, s)
+            stats_add_block(&slot_stats[s], buffer, count);
+
+#pragma omp task depend(in : slot_tokens[s]) firstprivate(buffer, start, count)                    \
+    shared(write_error)
+            {
+                unsigned long offset = SERIES_DATA_OFFSET + start * sizeof(unsigned long);
+                if (write_all(fd, buffer, count * sizeof(unsigned long), offset) != 0) {
+#pragma omp atomic write
+                    write_error = errno;
+                }
+            }
+        }
+    }
+    // All tasks are finished here: there is an implicit barrier at the end of single, and a
+    // barrier waits for all tasks of the team.
+
+    stats_init(result);
+    for (unsigned long s = 0; s < num_slots; s++) {
+        stats_combine(result, &slot_stats[s]);
+    }
+
+    // The header is written last, so a file with a valid header is always complete.
+    series_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SERIES_MAGIC, sizeof(header.magic));
+    header.version = SERIES_VERSION;
+    header.byte_order = SERIES_BYTE_ORDER;
+    header.element_size = sizeof(unsigned long);
+    header.count = n;
+    header.data_offset = SERIES_DATA_OFFSET;
+    header.sum = result->sum;
+    header.min = result->min;
+    header.max = result->max;
+    header.even_count = result->even_count;
+    header.mean = result->mean;
+    header.variance = stats_variance(result);
+
+    if (write_error == 0 && write_all(fd, &header, sizeof(header), 0) != 0) {
+        write_error = errno;
+    }
+    if (close(fd) != 0 && write_error == 0) {
+        write_error = errno;
+    }
+    if (write_error != 0) {
+        fprintf(stderr, "%s: write failed: %s\n", path, strerror(write_error));
+    }
+
+    free(buffers);
+    free(slot_stats);
+    free(slot_tokens);
+    return write_error != 0 ? -1 : 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * Generate, summarize and save the triangular-number series in overlapping stages.
+ *
+ * The series is split into chunks. Every chunk k goes through three tasks:
+ *
+ *      generate k  -- fill a buffer with the elements of chunk k (seeded from the closed form, see
+ *                     triangular.h)
+ *      stats k     -- add the buffer to the statistics (stats.h)
+ *      write k     -- pwrite() the buffer to its place in the output file
+ *
+ * The tasks are created by one thread and run by the whole team. "depend" clauses tell OpenMP the
+ * order they must run in, and OpenMP runs every task as soon as the tasks it depends on are done.
+ * There are PIPELINE_SLOTS_PER_THREAD buffers per thread, used round-robin (chunk k uses slot
+ * k % slots):
+ *
+ *      generate k: depend(inout: slot)  -- waits for stats and write of the previous chunk in the
+ *                                          same slot, because it overwrites the buffer
+ *      stats k:    depend(in: slot)     -- waits for generate k
+ *      write k:    depend(in: slot)     -- waits for generate k; can run at the same time as
+ *                                          stats k, because both only read the buffer
+ *
+ * So while one chunk is being written to disk, the next chunks are already being generated and
+ * summarized, and compute overlaps I/O. The output file format is described in series_file.h.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "stats.h"
+
+#define PIPELINE_CHUNK (1UL << 18) // elements per chunk (2 MiB)
+#define PIPELINE_SLOTS_PER_THREAD 2
+
+// Write T(0), ..., T(n - 1) to "path" and compute their statistics. Returns 0 on success and -1
+// (with a message on stderr) if the file cannot be written.
+int pipeline_run(const char* path, unsigned long n, unsigned int thread_count, stats* result);
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ * NUMA placement report. See placement.h.
+ */
+
+#include "placement.h"
+
+#include <omp.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "range.h"
+
+void placement_record_thread(placement_thread* threads) {
+    placement_thread* self = &threads[omp_get_thread_num()];
+    unsigned int cpu, node;
+
+    // getcpu() returns the CPU and its node in one call.
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) {
+        self->cpu = cpu;
+        self->node = node;
+    } else {
+        self->cpu = -1;
+        self->node = -1;
+    }
+    self->place = omp_get_place_num();
+}
+
+// Read the first line of /sys/devices/system/cpu/cpu<cpu>/topology/<name> into text, without the
+// newline. Returns 0, or -1 if the file does not exist.
+static int read_topology(int cpu, const char* name, char* text, int size) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    int status = fgets(text, size, file) != NULL ? 0 : -1;
+    fclose(file);
+    text[strcspn(text, "\n")] = '\0';
+    return status;
+}
+
+int placement_cpu_topology(int cpu, placement_topology* topology) {
+    char text[32];
+    topology->core = -1;
+    topology->socket = -1;
+    strcpy(topology->siblings, "?");
+    if (cpu < 0) {
+        return -1;
+    }
+
+    if (read_topology(cpu, "core_id", text, sizeof(text)) == 0) {
+        topology->core = atoi(text);
+    }
+    if (read_topology(cpu, "physical_package_id", text, sizeof(text)) == 0) {
+        topology->socket = atoi(text);
+    }
+    if (read_topology(cpu, "thread_siblings_list", topology->siblings, sizeof(topology->siblings))
+        != 0) {
+        strcpy(topology->siblings, "?");
+        return -1;
+    }
+    return topology->core >= 0 && topology->socket >= 0 ? 0 : -1;
+}
+
+int placement_page_nodes(const void* const* addresses, unsigned long count, int* nodes) {
+    // move_pages() with no target nodes does not move anything; it reports where the pages are.
+    // pid 0 is this process.
+    if (syscall(SYS_move_pages, 0, count, addresses, NULL, nodes, 0) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Sample up to "samples" pages, evenly spread over thread t's block, and look up their nodes.
+// Returns the number of pages sampled, or -1 if the nodes cannot be looked up.
+static long sample_block(const void* data, unsigned long n, size_t element_size,
+                         unsigned long block_elements, unsigned int t, unsigned int thread_count,
+                         unsigned long samples, int* nodes) {
+    unsigned long num_blocks = (n + block_elements - 1) / block_elements;
+    unsigned long first_block, last_block;
+    range_block(num_blocks, t, thread_count, &first_block, &last_block);
+
+    unsigned long start = first_block * block_elements;
+    unsigned long end = last_block * block_elements < n ? last_block * block_elements : n;
+    if (start >= end) {
+        return 0;
+    }
+
+    uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    uintptr_t first_page = ((uintptr_t)data + start * element_size) / page_size;
+    uintptr_t last_page = ((uintptr_t)data + end * element_size - 1) / page_size;
+    unsigned long num_pages = last_page - first_page + 1;
+    unsigned long count = num_pages < samples ? num_pages : samples;
+
+    const void** addresses = malloc(count * sizeof(void*));
+    for (unsigned long k = 0; k < count; k++) {
+        addresses[k] = (const void*)((first_page + k * num_pages / count) * page_size);
+    }
+    int status = placement_page_nodes(addresses, count, nodes);
+    free(addresses);
+
+    return status == 0 ? (long)count : -1;
+}
+
+double placement_local_fraction(const void* data, unsigned long n, size_t element_size,
+                                unsigned long block_elements, const placement_thread* threads,
+                                unsigned int thread_count, unsigned long samples) {
+    int* nodes = malloc(samples * sizeof(int));
+    unsigned long local = 0;
+    unsigned long total = 0;
+
+    for (unsigned int t = 0; t < thread_count; t++) {
+        long count = sample_block(data, n, element_size, block_elements, t, thread_count,
+                                  samples, nodes);
+        if (count < 0) {
+            free(nodes);
+            return -1.0;
+        }
+        for (long k = 0; k < count; k++) {
+            local += nodes[k] == threads[t].node;
+        }
+        total += count;
+    }
+
+    free(nodes);
+    return total > 0 ? (double)local / total : -1.0;
+}
+
+void placement_report(FILE* out, const void* data, unsigned long n, size_t element_size,
+                      unsigned long block_elements, const placement_thread* threads,
+                      unsigned int thread_count, unsigned long samples) {
+    int* nodes = malloc(samples * sizeof(int));
+
+    fprintf(out, "Threads and the pages of their blocks (up to %lu pages sampled per thread):\n",
+            samples);
+    for (unsigned int t = 0; t < thread_count; t++) {
+        fprintf(out, "  thread %3u: cpu %3d, node %2d, place %3d | ", t, threads[t].cpu,
+                threads[t].node, threads[t].place);
+
+        long count = sample_block(data, n, element_size, block_elements, t, thread_count,
+                                  samples, nodes);
+        if (count < 0) {
+            fprintf(out, "pages: unknown (move_pages not available)\n");
+            continue;
+        }
+        if (count == 0) {
+            fprintf(out, "no pages (empty block)\n");
+            continue;
+        }
+
+        unsigned long per_node[PLACEMENT_MAX_NODES] = { 0 };
+        unsigned long untouched = 0;
+        unsigned long local = 0;
+        for (long k = 0; k < count; k++) {
+            if (nodes[k] >= 0 && nodes[k] < PLACEMENT_MAX_NODES) {
+                per_node[nodes[k]]++;
+            } else {
+                untouched++;
+            }
+            local += nodes[k] == threads[t].node;
+        }
+
+        fprintf(out, "pages:");
+        for (int node = 0; node < PLACEMENT_MAX_NODES; node++) {
+            if (per_node[node] > 0) {
+                fprintf(out, " node %d: %lu", node, per_node[node]);
+            }
+        }
+        if (untouched > 0) {
+            fprintf(out, " not present: %lu", untouched);
+        }
+        fprintf(out, " (%.0f%% local)\n", 100.0 * local / count);
+    }
+
+    free(nodes);
+}
@@ -0,0 +1,72 @@
+/*
+ * Where do the threads run and where does the memory live? (NUMA placement report)
+ *
+ * On a machine with several processor sockets, every socket has its own memory: a NUMA node. A
+ * core reads the memory of its own node faster than the memory of another node. Linux puts a page
+ * of memory on the node of the thread that first writes to it ("first touch"), not the one that
+ * called malloc(). So an array that the master thread initializes alone ends up on the master's
+ * node, and every other socket reads it remotely, sharing the bandwidth of one node.
+ *
+ * The fix is to initialize the array in parallel with the same partition as the loops that read
+ * it later, so that every thread first touches the pages it will use, and to keep the threads
+ * from moving between nodes (OMP_PROC_BIND, OMP_PLACES). This module checks whether that worked:
+ *
+ *      placement_record_thread() -- inside a parallel region: the CPU, node and OpenMP place of
+ *                                   the calling thread
+ *      placement_page_nodes()    -- the node of the page holding each of a list of addresses
+ *                                   (the move_pages system call, without moving anything)
+ *      placement_report()        -- print the threads, and for every thread's block of an array
+ *                                   which nodes its pages are on and how many are local
+ *      placement_cpu_topology()  -- the core, socket and SMT siblings of a CPU (from sysfs)
+ *
+ * The system calls are made directly, so there is no dependency on libnuma. On a machine with a
+ * single node every page is on node 0.
+ */
+
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define PLACEMENT_MAX_NODES 64
+
+typedef struct {
+    int cpu;   // CPU the thread was running on, -1 if unknown
+    int node;  // NUMA node of that CPU, -1 if unknown
+    int place; // omp_get_place_num(), -1 if the thread is not bound to a place
+} placement_thread;
+
+// Where a CPU sits in the machine, from /sys/devices/system/cpu/cpuN/topology.
+typedef struct {
+    int core;          // core_id (unique within the socket), -1 if unknown
+    int socket;        // physical_package_id, -1 if unknown
+    char siblings[64]; // thread_siblings_list: the CPUs sharing the core (SMT), e.g. "3,67"
+} placement_topology;
+
+// Record where the calling thread runs in threads[omp_get_thread_num()]. Call inside a parallel
+// region; threads must have room for every thread of the team.
+void placement_record_thread(placement_thread* threads);
+
+// Look up the topology of a CPU. Returns 0, or -1 if sysfs does not have all of it (the unknown
+// fields are -1 or "?").
+int placement_cpu_topology(int cpu, placement_topology* topology);
+
+// Store the node of the page holding addresses[i] in nodes[i], or a negative errno (-ENOENT: the
+// page has not been touched yet). Returns 0, or -1 if the system call is not available.
+int placement_page_nodes(const void* const* addresses, unsigned long count, int* nodes);
+
+// Fraction (0 to 1) of the sampled pages of every thread's block that are on the thread's node.
+// Thread t's block is the one schedule(static) gives it over blocks of block_elements elements,
+// like stats_compute(). At most samples pages are checked per thread. Returns -1 if unknown.
+double placement_local_fraction(const void* data, unsigned long n, size_t element_size,
+                                unsigned long block_elements, const placement_thread* threads,
+                                unsigned int thread_count, unsigned long samples);
+
+// Print a table of the threads and, for every thread's block (as above), the number of sampled
+// pages on each node.
+void placement_report(FILE* out, const void* data, unsigned long n, size_t element_size,
+                      unsigned long block_elements, const placement_thread* threads,
+                      unsigned int thread_count, unsigned long samples);
+
+#endif
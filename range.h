@@ -0,0 +1,23 @@
+/*
+ * Splitting a range of loop iterations into contiguous blocks, one per thread.
+ *
+ * The tutorial programs compute a thread's bounds as (n * tid) / num_threads. That is simple, but
+ * n * tid overflows when n is large. Here the bounds are computed with division first, so they
+ * are correct for any n. The blocks are the same as the ones OpenMP uses for schedule(static)
+ * without a chunk size: the first (n % parts) blocks get one extra element.
+ */
+
+#ifndef RANGE_H
+#define RANGE_H
+
+// Bounds [start, end) of block "id" when [0, n) is split into "parts" contiguous blocks.
+static inline void range_block(unsigned long n, unsigned long id, unsigned long parts,
+                               unsigned long* start, unsigned long* end) {
+    unsigned long base = n / parts;
+    unsigned long extra = n % parts;
+
+    *start = id * base + (id < extra ? id : extra);
+    *end = *start + base + (id < extra ? 1 : 0);
+}
+
+#endif
@@ -0,0 +1,264 @@
+/*
+ * Benchmark of the generic reductions of parallel_reduce.hpp against the hand-written pragmas.
+ *
+ * Every kernel is written twice: once the way the tutorial programs write it (a pragma with a
+ * reduction clause, or the C kernels of sum_kernels.h), and once as an instantiation of
+ * parallel_reduce / parallel_transform_reduce. The templates are only worth having if they cost
+ * nothing, so the interesting column is relative_time (template time / hand-written time), which
+ * should be close to 1.
+ *
+ *      sum_parallel_for  -- sum of 1 .. n like parallel_for.c (sum_parallel_for())
+ *      sum_dynamic       -- the same with schedule(dynamic, 1024) (sum_schedule())
+ *      sum_guided        -- the same with schedule(guided) (sum_schedule())
+ *      array_sum         -- sum of the triangular series of bug_hunt_solution.c, stored in an array
+ *      array_max         -- the largest element of that array, with a max reduction
+ *      series_stats      -- sum, min, max and even count of the array in one pass, like the fixed
+ *                           bug_hunt.c: four reduction clauses by hand, one struct and one
+ *                           operator with the template
+ *
+ * Compile:
+ *  make reduce_bench
+ * Run:     ./reduce_bench [--threads LIST] [--size N] [--warmup N] [--trials N]
+ * Example: ./reduce_bench --threads 1,2,4,8 --size 100000000 > reduce.csv
+ */
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "parallel_reduce.hpp"
+
+extern "C" {
+#include "bench.h"
+#include "sum_kernels.h"
+#include "triangular.h"
+}
+
+using namespace omp_tutorial;
+
+// What a kernel computes. Scalar kernels use only values[0].
+struct reduce_result {
+    unsigned long values[4];
+};
+
+struct reduce_input {
+    const unsigned long* data; // the triangular series
+    unsigned long n;
+    unsigned int thread_count;
+};
+
+typedef reduce_result (*reduce_kernel)(const reduce_input& input);
+
+// The statistics of bug_hunt_solution.c as one value, and the operator that merges two of them.
+struct series_stats {
+    unsigned long sum;
+    unsigned long min;
+    unsigned long max;
+    unsigned long even_count;
+};
+
+struct series_stats_op {
+    static series_stats identity() {
+        return { 0, ULONG_MAX, 0, 0 };
+    }
+    static series_stats combine(series_stats a, series_stats b) {
+        return { a.sum + b.sum, b.min < a.min ? b.min : a.min, a.max < b.max ? b.max : a.max,
+                 a.even_count + b.even_count };
+    }
+};
+
+static reduce_result hand_sum_parallel_for(const reduce_input& input) {
+    return { { sum_parallel_for(input.n, input.thread_count) } };
+}
+
+static reduce_result template_sum_parallel_for(const reduce_input& input) {
+    return { { parallel_transform_reduce<unsigned long>(
+        1UL, input.n + 1, [](unsigned long i) { return i; }, input.thread_count) } };
+}
+
+static reduce_result hand_sum_dynamic(const reduce_input& input) {
+    return { { sum_schedule(input.n, input.thread_count, omp_sched_dynamic, 1024) } };
+}
+
+static reduce_result template_sum_dynamic(const reduce_input& input) {
+    return { { parallel_transform_reduce<unsigned long, plus_op<unsigned long>,
+                                         dynamic_schedule<1024>>(
+        1UL, input.n + 1, [](unsigned long i) { return i; }, input.thread_count) } };
+}
+
+static reduce_result hand_sum_guided(const reduce_input& input) {
+    return { { sum_schedule(input.n, input.thread_count, omp_sched_guided, 0) } };
+}
+
+static reduce_result template_sum_guided(const reduce_input& input) {
+    return { { parallel_transform_reduce<unsigned long, plus_op<unsigned long>, guided_schedule<>>(
+        1UL, input.n + 1, [](unsigned long i) { return i; }, input.thread_count) } };
+}
+
+static reduce_result hand_array_sum(const reduce_input& input) {
+    const unsigned long* data = input.data;
+    unsigned long sum = 0;
+
+#pragma omp parallel for num_threads(input.thread_count) reduction(+ : sum)
+    for (unsigned long i = 0; i < input.n; i++) {
+        sum += data[i];
+    }
+
+    return { { sum } };
+}
+
+static reduce_result template_array_sum(const reduce_input& input) {
+    return { { parallel_reduce<unsigned long>(input.data, input.n, input.thread_count) } };
+}
+
+static reduce_result hand_array_max(const reduce_input& input) {
+    const unsigned long* data = input.data;
+    unsigned long max_val = 0;
+
+#pragma omp parallel for num_threads(input.thread_count) reduction(max : max_val)
+    for (unsigned long i = 0; i < input.n; i++) {
+        max_val = data[i] > max_val ? data[i] : max_val;
+    }
+
+    return { { max_val } };
+}
+
+static reduce_result template_array_max(const reduce_input& input) {
+    return { { parallel_reduce<unsigned long, max_op<unsigned long>>(input.data, input.n,
+                                                                     input.thread_count) } };
+}
+
+static reduce_result hand_series_stats(const reduce_input& input) {
+    const unsigned long* data = input.data;
+    unsigned long sum = 0, even_count = 0;
+    unsigned long min_val = ULONG_MAX, max_val = 0;
+
+#pragma omp parallel for num_threads(input.thread_count) reduction(+ : sum, even_count)         \
+    reduction(min : min_val) reduction(max : max_val)
+    for (unsigned long i = 0; i < input.n; i++) {
+        unsigned long value = data[i];
+        sum += value;
+        even_count += ~value & 1;
+        min_val = value < min_val ? value : min_val;
+        max_val = value > max_val ? value : max_val;
+    }
+
+    return { { sum, min_val, max_val, even_count } };
+}
+
+static reduce_result template_series_stats(const reduce_input& input) {
+    const unsigned long* data = input.data;
+    series_stats s = parallel_transform_reduce<series_stats, series_stats_op>(
+        0UL, input.n,
+        [data](unsigned long i) {
+            unsigned long value = data[i];
+            return series_stats { value, value, value, ~value & 1 };
+        },
+        input.thread_count);
+
+    return { { s.sum, s.min, s.max, s.even_count } };
+}
+
+static const struct {
+    const char* name;
+    reduce_kernel hand;
+    reduce_kernel generic;
+} kernels[] = {
+    { "sum_parallel_for", hand_sum_parallel_for, template_sum_parallel_for },
+    { "sum_dynamic", hand_sum_dynamic, template_sum_dynamic },
+    { "sum_guided", hand_sum_guided, template_sum_guided },
+    { "array_sum", hand_array_sum, template_array_sum },
+    { "array_max", hand_array_max, template_array_max },
+    { "series_stats", hand_series_stats, template_series_stats },
+};
+
+static const unsigned int num_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+struct kernel_run {
+    reduce_kernel kernel;
+    reduce_input input;
+    reduce_result result;
+};
+
+static void run_kernel(void* arg) {
+    kernel_run* run = static_cast<kernel_run*>(arg);
+    run->result = run->kernel(run->input);
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--threads LIST] [--size N] [--warmup N] [--trials N]\n", program);
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads[BENCH_MAX_LIST];
+    int num_threads = bench_default_threads(threads, BENCH_MAX_LIST);
+    unsigned long n = 1UL << 24;
+    bench_config config = { 1, 5 }; // warmup, trials
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(argv[i], "--threads") == 0) {
+            num_threads = bench_parse_list(argv[++i], threads, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--size") == 0) {
+            n = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--warmup") == 0) {
+            config.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--trials") == 0) {
+            config.trials = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (num_threads < 0 || n == 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // The triangular series of bug_hunt_solution.c: 1 + 2 + ... + (i + 1).
+    unsigned long* data = static_cast<unsigned long*>(malloc(n * sizeof(unsigned long)));
+    if (data == NULL) {
+        fprintf(stderr, "Cannot allocate %lu numbers\n", n);
+        return EXIT_FAILURE;
+    }
+#pragma omp parallel for schedule(static)
+    for (unsigned long i = 0; i < n; i++) {
+        data[i] = triangular(i);
+    }
+
+    printf("kernel,implementation,threads,size,min_s,median_s,p95_s,relative_time,same_result\n");
+
+    int status = EXIT_SUCCESS;
+    for (unsigned int k = 0; k < num_kernels; k++) {
+        for (int t = 0; t < num_threads; t++) {
+            reduce_input input = { data, n, static_cast<unsigned int>(threads[t]) };
+            kernel_run hand = { kernels[k].hand, input, {} };
+            kernel_run generic = { kernels[k].generic, input, {} };
+
+            bench_result hand_time, generic_time;
+            bench_measure(&config, run_kernel, &hand, &hand_time);
+            bench_measure(&config, run_kernel, &generic, &generic_time);
+
+            int same = memcmp(&hand.result, &generic.result, sizeof(reduce_result)) == 0;
+            if (!same) {
+                status = EXIT_FAILURE;
+            }
+
+            printf("%s,hand,%u,%lu,%.9f,%.9f,%.9f,1.000,yes\n", kernels[k].name, input.thread_count,
+                   n, hand_time.min, hand_time.median, hand_time.p95);
+            printf("%s,template,%u,%lu,%.9f,%.9f,%.9f,%.3f,%s\n", kernels[k].name,
+                   input.thread_count, n, generic_time.min, generic_time.median, generic_time.p95,
+                   generic_time.median / hand_time.median, same ? "yes" : "no");
+            fflush(stdout);
+        }
+    }
+
+    free(data);
+    return status;
+}
@@ -20,25 +20,58 @@
  * result is stored in the original variable.
  *
  * Caution: floating-point reduction can lead to non-deterministic results due to the
- * non-associative nature of floating-point arithmetic.
+ * non-associative nature of floating-point arithmetic. fsum.h shows how to get the same bits on
+ * any number of threads.
  *
  * NOTE: Eventhough subtraction is not associative, it is still allowed in reduction clause because
  * OpenMP internally converts it to addition of partial results with appropriate sign changes.
  * For example: a - b - c can be expressed as a + (-b) + (-c) to make subtraction associative.
+ *
+ * NOTE: global_sum is an unsigned long, so the sum wraps around (silently) when it gets larger than
+ * 2^64 - 1, which happens for upper_bound above about 6 * 10^9. With "--wide" the program sums
+ * into 128-bit integers instead (see wide_sum.h), which is exact for upper bounds up to 2^63.
+ *
+ * Compile:
+ *  make reduction
+ * OR
+ *  gcc -fopenmp -o reduction reduction.c wide_sum.c
  */
 
 #include <omp.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "range.h"
+#include "wide_sum.h"
+
+// The same sum with 128-bit results (see wide_sum.h), for upper bounds whose sum does not fit in an
+// unsigned long (above about 6 * 10^9).
+static int sum_wide(unsigned int thread_count, unsigned long upper_bound) {
+    char computed[WIDE_DIGITS], expected[WIDE_DIGITS];
+
+    wide_uint global_sum = wide_sum_range(1, upper_bound, thread_count);
+    wide_uint expected_sum = wide_sum_expected(1, upper_bound);
+
+    printf("Expected sum from 1 to %lu: %s\n", upper_bound, wide_format(expected_sum, expected));
+    printf("Sum we computed from 1 to %lu: %s\n", upper_bound, wide_format(global_sum, computed));
+    printf("Result is %s\n", (global_sum == expected_sum) ? "correct!!!" : "incorrect!");
+
+    return EXIT_SUCCESS;
+}
 
 int main(int argc, char** argv) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <num_threads> <upper_bound>\n", argv[0]);
+    if (argc != 3 && !(argc == 4 && strcmp(argv[3], "--wide") == 0)) {
+        fprintf(stderr, "Usage: %s <num_threads> <upper_bound> [--wide]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
     unsigned int thread_count = atoi(argv[1]);
-    unsigned long upper_bound = atol(argv[2]);
+    unsigned long upper_bound = strtoul(argv[2], NULL, 10);
+
+    if (argc == 4) {
+        return sum_wide(thread_count, upper_bound);
+    }
 
     unsigned long global_sum = 0;
 
@@ -46,9 +79,12 @@ int main(int argc, char** argv) {
     {
         unsigned int tid = omp_get_thread_num();
 
-        // Calculate bounds for each thread
-        unsigned long local_start = (upper_bound * tid) / thread_count + 1;
-        unsigned long local_end = (upper_bound * (tid + 1)) / thread_count;
+        // Calculate bounds for each thread. The simple formula (upper_bound * tid) / thread_count
+        // overflows when upper_bound is large, so range_block() divides first (see range.h).
+        unsigned long block_start, block_end;
+        range_block(upper_bound, tid, thread_count, &block_start, &block_end);
+        unsigned long local_start = block_start + 1;
+        unsigned long local_end = block_end;
 
         printf("Thread %u: local_start = %lu, local_end = %lu\n", tid, local_start, local_end);
 
@@ -62,8 +98,10 @@ int main(int argc, char** argv) {
 
     printf("\n");
 
-    // Expected sum from 1 to n is (n*(n+1))/2, so using this formula to verify our result.
-    unsigned long expected_sum = (upper_bound * (upper_bound + 1)) / 2;
+    // Expected sum from 1 to n is (n*(n+1))/2, so using this formula to verify our result. One of n
+    // and n+1 is even; halving it before the multiplication keeps n*(n+1) from overflowing.
+    unsigned long expected_sum = upper_bound % 2 == 0 ? (upper_bound / 2) * (upper_bound + 1)
+                                                       : upper_bound * ((upper_bound + 1) / 2);
     printf("Expected sum from 1 to %lu: %lu\n", upper_bound, expected_sum);
     printf("Sum we computed from 1 to %lu: %lu\n", upper_bound, global_sum);
     printf("Result is %s\n", (global_sum == expected_sum) ? "correct!!!" : "incorrect!");
@@ -0,0 +1,505 @@
+/*
+ * Strong and weak scaling analysis of the parallel_for.c sum and the bug_hunt_solution.c pass.
+ *
+ * A run that gets slower with more threads can be slow for two different reasons: part of the work
+ * is serial (Amdahl's law), or the parallel part pays an overhead that grows with the number of
+ * threads (team start, scheduling, memory bandwidth). Raw timings don't separate the two; the
+ * metrics below do.
+ *
+ * Strong scaling keeps the problem size fixed (the same upper_bound or n for every thread count).
+ * With T(p) the median time on p threads:
+ *
+ *      speedup     S(p) = T(1) / T(p)
+ *      efficiency  E(p) = S(p) / p
+ *      Karp-Flatt  e(p) = (1 / S(p) - 1 / p) / (1 - 1 / p)     (p > 1)
+ *
+ * e(p) is the experimentally determined serial fraction: the serial fraction Amdahl's law would
+ * need to explain the measured speedup. If e(p) stays about the same as p grows, the code really
+ * has a serial part of that size. If e(p) grows with p, the loss is parallel overhead, and it will
+ * get worse on larger machines. The program also fits Amdahl's law
+ *
+ *      S(p) = 1 / (f + (1 - f) / p)
+ *
+ * to all thread counts (least squares on T(p) / T(1) = f + (1 - f) / p, which is linear in f),
+ * and reports f, the speedup the fitted curve predicts for every thread count and its limit 1 / f.
+ * A point far below the curve is overhead the model does not explain.
+ *
+ * Weak scaling keeps the work per thread fixed (size = p * the size per thread). Ideally T(p) is
+ * the same for every p:
+ *
+ *      efficiency      E(p) = T(1) / T(p)
+ *      scaled speedup  S(p) = p * E(p)
+ *
+ * with e(p) computed from the scaled speedup and Gustafson's law S(p) = p - f * (p - 1) fitted in
+ * the same way.
+ *
+ *      parallel_for       -- sum of 1 .. size like parallel_for.c (sum_parallel_for())
+ *      bug_hunt_solution  -- fill an array of "size" numbers, turn it into the triangular series
+ *                            with the blocked scan and compute its statistics, like
+ *                            bug_hunt_solution.c (scan.h, stats.h); the scan has a serial step
+ *
+ * The results are written as JSON on stdout. Thread counts above the number of processors are
+ * still measured, but marked as "oversubscribed": their efficiency says nothing about the code.
+ *
+ * Regression gate: --baseline FILE reads lines "kernel mode threads min_efficiency" (see
+ * scaling_baseline.txt) and makes the program fail if the efficiency of a measured, not
+ * oversubscribed thread count is below its minimum. "make scaling_check" runs it, and
+ * --save-baseline FILE writes such a file from the current run, minus a safety margin (--margin,
+ * 0.1 = 10% by default), so that a machine can record its own baseline with "make
+ * scaling_baseline".
+ *
+ * Compile:
+ *  make scaling
+ * Run:     ./scaling [--threads LIST] [--kernels LIST] [--modes LIST] [--strong-size N]
+ *                    [--weak-size N] [--warmup N] [--trials N] [--baseline FILE]
+ *                    [--save-baseline FILE] [--margin X]
+ * Example: ./scaling --threads 1,2,4,8 --modes strong > scaling.json
+ */
+
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "scan.h"
+#include "stats.h"
+#include "sum_kernels.h"
+#include "triangular.h"
+
+typedef enum { KERNEL_PARALLEL_FOR, KERNEL_BUG_HUNT, NUM_KERNELS } kernel_type;
+
+typedef enum { MODE_STRONG, MODE_WEAK, NUM_MODES } scaling_mode;
+
+static const char* const kernel_names[] = { "parallel_for", "bug_hunt_solution" };
+
+static const char* const mode_names[] = { "strong", "weak" };
+
+// Default sizes: the whole problem for strong scaling, the part of one thread for weak scaling.
+static const unsigned long default_strong_size[] = { 1UL << 30, 1UL << 25 };
+static const unsigned long default_weak_size[] = { 1UL << 28, 1UL << 22 };
+
+typedef struct {
+    kernel_type type;
+    unsigned long* data; // bug_hunt_solution: at least n numbers
+    unsigned long n;
+    unsigned int thread_count;
+    int correct;
+} scaling_run;
+
+typedef struct {
+    unsigned int threads;
+    unsigned long size;
+    bench_result time;
+    int correct;
+    double speedup;
+    double efficiency;
+    double karp_flatt; // NAN on 1 thread
+} scaling_point;
+
+// Every sweep of one run, for the baseline check.
+typedef struct {
+    int processors;
+    int num_counts; // thread counts per sweep
+    int measured[NUM_KERNELS][NUM_MODES];
+    scaling_point points[NUM_KERNELS][NUM_MODES][BENCH_MAX_LIST + 1];
+} scaling_results;
+
+static void run_kernel(void* arg) {
+    scaling_run* run = arg;
+
+    if (run->type == KERNEL_PARALLEL_FOR) {
+        run->correct = sum_parallel_for(run->n, run->thread_count) == sum_expected(run->n);
+        return;
+    }
+
+    // The array part of bug_hunt_solution.c.
+    unsigned long* array = run->data;
+    unsigned long n = run->n;
+#pragma omp parallel for num_threads(run->thread_count) schedule(static)
+    for (unsigned long i = 0; i < n; i++) {
+        array[i] = i + 1;
+    }
+    scan_inclusive(array, array, n, run->thread_count);
+
+    stats result;
+    stats_compute(array, n, run->thread_count, &result);
+    run->correct = result.count == n && result.max == triangular(n - 1);
+}
+
+// Karp-Flatt serial fraction for a speedup on p > 1 threads.
+static double karp_flatt(double speedup, unsigned int p) {
+    return (1.0 / speedup - 1.0 / p) / (1.0 - 1.0 / p);
+}
+
+/*
+ * Least-squares serial fraction, clamped to [0, 1]. Both laws are linear in f:
+ *
+ *      Amdahl:     T(p) / T(1) - 1 / p = f * (1 - 1 / p)
+ *      Gustafson:  p - S(p)            = f * (p - 1)
+ *
+ * so f = sum(x * y) / sum(x * x) with x and y the two sides. Oversubscribed thread counts are left
+ * out; NAN if no thread count above 1 is left.
+ */
+static double fit_serial_fraction(const scaling_point* points, int count, scaling_mode mode,
+                                  int processors) {
+    double xy = 0, xx = 0;
+
+    for (int i = 0; i < count; i++) {
+        double p = points[i].threads;
+        double x, y;
+        if (points[i].threads > (unsigned int)processors) {
+            continue;
+        }
+        if (mode == MODE_STRONG) {
+            x = 1.0 - 1.0 / p;
+            y = 1.0 / points[i].speedup - 1.0 / p;
+        } else {
+            x = p - 1.0;
+            y = p - points[i].speedup;
+        }
+        xy += x * y;
+        xx += x * x;
+    }
+
+    if (xx == 0) {
+        return NAN;
+    }
+    double f = xy / xx;
+    return f < 0 ? 0 : f > 1 ? 1 : f;
+}
+
+// JSON has no NaN or infinity; print null instead.
+static void print_number(double value) {
+    if (isfinite(value)) {
+        printf("%.6g", value);
+    } else {
+        printf("null");
+    }
+}
+
+// The thread counts to measure: 1 first (the reference for everything else), then the others.
+static int with_one_thread(const unsigned long* threads, int num_threads, unsigned int* counts) {
+    int count = 0;
+
+    counts[count++] = 1;
+    for (int t = 0; t < num_threads; t++) {
+        if (threads[t] != 1) {
+            counts[count++] = threads[t];
+        }
+    }
+
+    return count;
+}
+
+// Measure one kernel in one mode for every thread count and compute the metrics.
+static void sweep(kernel_type kernel, scaling_mode mode, unsigned long size,
+                  const unsigned int* counts, int num_counts, const bench_config* config,
+                  scaling_point* points) {
+    unsigned long max_n = 0;
+    for (int t = 0; t < num_counts; t++) {
+        unsigned long n = mode == MODE_STRONG ? size : size * counts[t];
+        max_n = n > max_n ? n : max_n;
+    }
+
+    unsigned long* data = NULL;
+    if (kernel == KERNEL_BUG_HUNT) {
+        data = malloc(max_n * sizeof(unsigned long));
+        if (data == NULL) {
+            fprintf(stderr, "Cannot allocate %lu numbers\n", max_n);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (int t = 0; t < num_counts; t++) {
+        scaling_point* point = &points[t];
+        scaling_run run = { .type = kernel, .data = data, .thread_count = counts[t] };
+        run.n = mode == MODE_STRONG ? size : size * counts[t];
+        bench_measure(config, run_kernel, &run, &point->time);
+
+        point->threads = counts[t];
+        point->size = run.n;
+        point->correct = run.correct;
+
+        double reference = points[0].time.median;
+        if (mode == MODE_STRONG) {
+            point->speedup = reference / point->time.median;
+            point->efficiency = point->speedup / point->threads;
+        } else {
+            point->efficiency = reference / point->time.median;
+            point->speedup = point->efficiency * point->threads;
+        }
+        point->karp_flatt = point->threads > 1 ? karp_flatt(point->speedup, point->threads) : NAN;
+    }
+
+    free(data);
+}
+
+static void print_sweep(kernel_type kernel, scaling_mode mode, unsigned long size,
+                        const scaling_point* points, int count, int processors, int first) {
+    double f = fit_serial_fraction(points, count, mode, processors);
+
+    printf("%s    {\n", first ? "" : ",\n");
+    printf("      \"kernel\": \"%s\",\n", kernel_names[kernel]);
+    printf("      \"mode\": \"%s\",\n", mode_names[mode]);
+    printf("      \"%s\": %lu,\n", mode == MODE_STRONG ? "size" : "size_per_thread", size);
+    printf("      \"fit\": { \"model\": \"%s\", \"serial_fraction\": ",
+           mode == MODE_STRONG ? "amdahl" : "gustafson");
+    print_number(f);
+    if (mode == MODE_STRONG) {
+        printf(", \"max_speedup\": ");
+        print_number(1.0 / f);
+    }
+    printf(" },\n");
+    printf("      \"points\": [\n");
+
+    for (int i = 0; i < count; i++) {
+        const scaling_point* point = &points[i];
+        double p = point->threads;
+        double model = mode == MODE_STRONG ? 1.0 / (f + (1.0 - f) / p) : p - f * (p - 1.0);
+
+        printf("        { \"threads\": %u, \"size\": %lu, \"min_s\": %.9f, \"median_s\": %.9f, "
+               "\"p95_s\": %.9f,\n",
+               point->threads, point->size, point->time.min, point->time.median, point->time.p95);
+        printf("          \"speedup\": ");
+        print_number(point->speedup);
+        printf(", \"efficiency\": ");
+        print_number(point->efficiency);
+        printf(", \"karp_flatt\": ");
+        print_number(point->karp_flatt);
+        printf(", \"model_speedup\": ");
+        print_number(isfinite(f) ? model : NAN);
+        printf(",\n          \"oversubscribed\": %s, \"correct\": %s }%s\n",
+               point->threads > (unsigned int)processors ? "true" : "false",
+               point->correct ? "true" : "false", i + 1 < count ? "," : "");
+    }
+
+    printf("      ]\n    }");
+    fflush(stdout);
+}
+
+/*
+ * Check the measured efficiencies against the baseline file. Returns the number of thread counts
+ * below their minimum, or -1 if the file cannot be read. Lines of the file are
+ *
+ *      kernel mode threads min_efficiency
+ *
+ * Empty lines and lines starting with '#' are ignored, and so are entries for thread counts that
+ * were not measured or that are oversubscribed on this machine.
+ */
+static int check_baseline(const char* path, const scaling_results* results) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    int failures = 0, checked = 0;
+    char line[256];
+    for (int line_number = 1; fgets(line, sizeof(line), file) != NULL; line_number++) {
+        char kernel_name[64], mode_name[16];
+        unsigned int threads;
+        double minimum;
+
+        char* text = line + strspn(line, " \t");
+        if (*text == '#' || *text == '\n' || *text == '\0') {
+            continue;
+        }
+        if (sscanf(text, "%63s %15s %u %lf", kernel_name, mode_name, &threads, &minimum) != 4) {
+            fprintf(stderr, "%s:%d: expected \"kernel mode threads min_efficiency\"\n", path,
+                    line_number);
+            fclose(file);
+            return -1;
+        }
+
+        int k = 0, m = 0;
+        while (k < NUM_KERNELS && strcmp(kernel_names[k], kernel_name) != 0) {
+            k++;
+        }
+        while (m < NUM_MODES && strcmp(mode_names[m], mode_name) != 0) {
+            m++;
+        }
+        if (k == NUM_KERNELS || m == NUM_MODES) {
+            fprintf(stderr, "%s:%d: unknown kernel or mode\n", path, line_number);
+            fclose(file);
+            return -1;
+        }
+        if (!results->measured[k][m] || threads > (unsigned int)results->processors) {
+            continue;
+        }
+
+        for (int t = 0; t < results->num_counts; t++) {
+            const scaling_point* point = &results->points[k][m][t];
+            if (point->threads != threads) {
+                continue;
+            }
+            checked++;
+            if (point->efficiency < minimum) {
+                fprintf(stderr, "%s %s scaling on %u threads: efficiency %.3f is below %.3f\n",
+                        kernel_name, mode_name, threads, point->efficiency, minimum);
+                failures++;
+            }
+        }
+    }
+
+    fclose(file);
+    fprintf(stderr, "Baseline %s: %d of %d checked thread counts below the minimum efficiency\n",
+            path, failures, checked);
+    return failures;
+}
+
+// Write a baseline file with the measured efficiencies minus the margin.
+static int save_baseline(const char* path, const scaling_results* results, double margin) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    fprintf(file, "# Minimum parallel efficiency for \"scaling --baseline\": measured on %d "
+                  "processors, minus %.0f%%.\n",
+            results->processors, margin * 100);
+    fprintf(file, "# kernel           mode    threads  min_efficiency\n");
+    for (int k = 0; k < NUM_KERNELS; k++) {
+        for (int m = 0; m < NUM_MODES; m++) {
+            for (int t = 0; results->measured[k][m] && t < results->num_counts; t++) {
+                const scaling_point* point = &results->points[k][m][t];
+                if (point->threads > 1 && point->threads <= (unsigned int)results->processors) {
+                    fprintf(file, "%-18s %-7s %-8u %.3f\n", kernel_names[k], mode_names[m],
+                            point->threads, point->efficiency * (1.0 - margin));
+                }
+            }
+        }
+    }
+
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+// Parse a comma-separated list of names into selected[]. Returns -1 for an unknown name.
+static int parse_names(const char* text, const char* const* names, int count, int* selected) {
+    char* list = strdup(text);
+    char* save;
+    int status = 0;
+
+    memset(selected, 0, count * sizeof(int));
+    for (char* name = strtok_r(list, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save)) {
+        int i = 0;
+        while (i < count && strcmp(names[i], name) != 0) {
+            i++;
+        }
+        if (i == count) {
+            status = -1;
+            break;
+        }
+        selected[i] = 1;
+    }
+
+    free(list);
+    return status;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--threads LIST] [--kernels parallel_for,bug_hunt_solution] "
+            "[--modes strong,weak] [--strong-size N] [--weak-size N] [--warmup N] [--trials N] "
+            "[--baseline FILE] [--save-baseline FILE] [--margin X]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads[BENCH_MAX_LIST];
+    int num_threads = bench_default_threads(threads, BENCH_MAX_LIST);
+    int kernels[NUM_KERNELS] = { 1, 1 };
+    int modes[NUM_MODES] = { 1, 1 };
+    unsigned long strong_size = 0, weak_size = 0; // 0: the default of each kernel
+    const char* baseline = NULL;
+    const char* save = NULL;
+    double margin = 0.1;
+    bench_config config = { .warmup = 1, .trials = 5 };
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        int status = 0;
+        if (strcmp(argv[i], "--threads") == 0) {
+            num_threads = bench_parse_list(argv[++i], threads, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--kernels") == 0) {
+            status = parse_names(argv[++i], kernel_names, NUM_KERNELS, kernels);
+        } else if (strcmp(argv[i], "--modes") == 0) {
+            status = parse_names(argv[++i], mode_names, NUM_MODES, modes);
+        } else if (strcmp(argv[i], "--strong-size") == 0) {
+            strong_size = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--weak-size") == 0) {
+            weak_size = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--warmup") == 0) {
+            config.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--trials") == 0) {
+            config.trials = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--baseline") == 0) {
+            baseline = argv[++i];
+        } else if (strcmp(argv[i], "--save-baseline") == 0) {
+            save = argv[++i];
+        } else if (strcmp(argv[i], "--margin") == 0) {
+            margin = atof(argv[++i]);
+        } else {
+            status = -1;
+        }
+
+        if (status < 0 || num_threads < 0 || margin < 0 || margin >= 1) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    unsigned int counts[BENCH_MAX_LIST + 1];
+    static scaling_results results;
+    results.num_counts = with_one_thread(threads, num_threads, counts);
+    results.processors = omp_get_num_procs();
+    int num_sweeps = 0, correct = 1;
+
+    printf("{\n  \"processors\": %d,\n  \"warmup\": %u,\n  \"trials\": %u,\n  \"sweeps\": [\n",
+           results.processors, config.warmup, config.trials);
+
+    for (int k = 0; k < NUM_KERNELS; k++) {
+        for (int m = 0; m < NUM_MODES; m++) {
+            if (!kernels[k] || !modes[m]) {
+                continue;
+            }
+
+            unsigned long size = m == MODE_STRONG ? strong_size : weak_size;
+            if (size == 0) {
+                size = m == MODE_STRONG ? default_strong_size[k] : default_weak_size[k];
+            }
+
+            scaling_point* points = results.points[k][m];
+            sweep(k, m, size, counts, results.num_counts, &config, points);
+            print_sweep(k, m, size, points, results.num_counts, results.processors,
+                        num_sweeps++ == 0);
+            results.measured[k][m] = 1;
+
+            for (int t = 0; t < results.num_counts; t++) {
+                if (!points[t].correct) {
+                    fprintf(stderr, "%s %s scaling: incorrect result on %u threads\n",
+                            kernel_names[k], mode_names[m], counts[t]);
+                    correct = 0;
+                }
+            }
+        }
+    }
+
+    printf("\n  ]\n}\n");
+
+    int status = correct ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (save != NULL && save_baseline(save, &results, margin) != 0) {
+        status = EXIT_FAILURE;
+    }
+    if (baseline != NULL && check_baseline(baseline, &results) != 0) {
+        status = EXIT_FAILURE;
+    }
+
+    return status;
+}
@@ -0,0 +1,82 @@
+/*
+ * Two-pass blocked parallel prefix sum. See scan.h for the description of the algorithm.
+ */
+
+#include "scan.h"
+
+#include <omp.h>
+#include <stdlib.h>
+
+#include "range.h"
+
+static void scan_blocked(const unsigned long* in, unsigned long* out, unsigned long n,
+                         unsigned long init, unsigned int thread_count, int inclusive) {
+    if (n == 0) {
+        return;
+    }
+
+    // offsets[t] is the starting value of block t after the "between" step.
+    unsigned long* offsets = NULL;
+
+#pragma omp parallel num_threads(thread_count) default(none)                                       \
+    shared(in, out, n, init, inclusive, offsets)
+    {
+        unsigned int tid = omp_get_thread_num();
+        unsigned int num_threads = omp_get_num_threads();
+
+        // Only one thread allocates. The implicit barrier at the end of single makes sure every
+        // thread sees the allocated array before using it.
+#pragma omp single
+        offsets = malloc((num_threads + 1) * sizeof(unsigned long));
+
+        unsigned long start, end;
+        range_block(n, tid, num_threads, &start, &end);
+
+        // Pass 1: total of this thread's block. Slot tid + 1 so that slot 0 can hold "init".
+        unsigned long block_sum = 0;
+        for (unsigned long i = start; i < end; i++) {
+            block_sum += in[i];
+        }
+        offsets[tid + 1] = block_sum;
+
+        // Every block total must be written before we turn them into offsets.
+#pragma omp barrier
+
+        // Serial scan of the per-thread totals. This is only num_threads additions. The implicit
+        // barrier at the end of single publishes the offsets to all threads.
+#pragma omp single
+        {
+            offsets[0] = init;
+            for (unsigned int t = 1; t <= num_threads; t++) {
+                offsets[t] += offsets[t - 1];
+            }
+        }
+
+        // Pass 2 (fix-up): scan this block again, starting from the sum of all previous blocks.
+        unsigned long running = offsets[tid];
+        if (inclusive) {
+            for (unsigned long i = start; i < end; i++) {
+                running += in[i];
+                out[i] = running;
+            }
+        } else {
+            for (unsigned long i = start; i < end; i++) {
+                unsigned long value = in[i]; // read first because "in" and "out" may alias
+                out[i] = running;
+                running += value;
+            }
+        }
+    }
+
+    free(offsets);
+}
+
+void scan_inclusive(const unsigned long* in, unsigned long* out, unsigned long n,
+                    unsigned int thread_count) {
+    scan_blocked(in, out, n, 0, thread_count, 1);
+}
+
+void scan_exclusive(const unsigned long* in, unsigned long* out, unsigned long n,
+                    unsigned long init, unsigned int thread_count) {
+    scan_blocked(in, out, n, init, thread_count, 0);
+}
@@ -0,0 +1,34 @@
+/*
+ * Parallel prefix sum (scan) for arrays of unsigned long.
+ *
+ * A prefix sum turns an input array into running totals:
+ *
+ *      inclusive: out[i] = in[0] + in[1] + ... + in[i]
+ *      exclusive: out[i] = init + in[0] + in[1] + ... + in[i - 1]
+ *
+ * Every output depends on all previous inputs, so it looks like a loop-carried dependency (see
+ * BUG 1 in bug_hunt_solution.c). It can still be parallelized because addition is associative: we
+ * can sum parts of the array independently and combine the partial sums afterwards.
+ *
+ * The scan is done in two passes over contiguous blocks, one block per thread:
+ *      Pass 1: Each thread sums its own block and stores the total in a per-thread slot.
+ *      Between: One thread turns the per-thread totals into per-thread starting offsets.
+ *      Pass 2: Each thread scans its own block again, starting from its offset (the fix-up pass).
+ *
+ * Unsigned addition wraps around modulo 2^64 and is associative, so the result is bit-for-bit
+ * identical to the serial loop for any number of threads. "in" and "out" may point to the same
+ * array (in-place scan).
+ */
+
+#ifndef SCAN_H
+#define SCAN_H
+
+// Inclusive scan of in[0..n) into out[0..n) using thread_count threads.
+void scan_inclusive(const unsigned long* in, unsigned long* out, unsigned long n,
+                    unsigned int thread_count);
+
+// Exclusive scan of in[0..n) into out[0..n) starting from init, using thread_count threads.
+void scan_exclusive(const unsigned long* in, unsigned long* out, unsigned long n,
+                    unsigned long init, unsigned int thread_count);
+
+#endif
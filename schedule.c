@@ -0,0 +1,71 @@
+/*
+ * Schedule text helpers. See schedule.h.
+ */
+
+#include "schedule.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const struct {
+    const char* name;
+    omp_sched_t kind;
+} kinds[] = {
+    { "static", omp_sched_static },
+    { "dynamic", omp_sched_dynamic },
+    { "guided", omp_sched_guided },
+    { "auto", omp_sched_auto },
+};
+
+static const unsigned int num_kinds = sizeof(kinds) / sizeof(kinds[0]);
+
+int schedule_parse(const char* text, omp_sched_t* kind, int* chunk_size) {
+    const char* comma = strchr(text, ',');
+    size_t name_length = comma != NULL ? (size_t)(comma - text) : strlen(text);
+
+    unsigned int k = 0;
+    while (k < num_kinds
+           && (strlen(kinds[k].name) != name_length
+               || strncmp(kinds[k].name, text, name_length) != 0)) {
+        k++;
+    }
+    if (k == num_kinds) {
+        return -1;
+    }
+
+    *kind = kinds[k].kind;
+    *chunk_size = 0;
+
+    if (comma != NULL) {
+        char* end;
+        long chunk = strtol(comma + 1, &end, 10);
+        // auto does not take a chunk size.
+        if (end == comma + 1 || *end != '\0' || chunk < 1 || *kind == omp_sched_auto) {
+            return -1;
+        }
+        *chunk_size = (int)chunk;
+    }
+
+    return 0;
+}
+
+const char* schedule_kind_name(omp_sched_t kind) {
+    // The monotonic modifier may be OR-ed into the kind, so compare without it.
+    omp_sched_t base = kind & ~omp_sched_monotonic;
+
+    for (unsigned int k = 0; k < num_kinds; k++) {
+        if (kinds[k].kind == base) {
+            return kinds[k].name;
+        }
+    }
+    return "unknown";
+}
+
+void schedule_format(omp_sched_t kind, int chunk_size, char* buffer, unsigned long size) {
+    if (chunk_size > 0) {
+        snprintf(buffer, size, "%s,%d", schedule_kind_name(kind), chunk_size);
+    } else {
+        snprintf(buffer, size, "%s", schedule_kind_name(kind));
+    }
+}
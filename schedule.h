@@ -0,0 +1,21 @@
+/*
+ * Helpers to read and print OpenMP loop schedules as text, in the same format as the OMP_SCHEDULE
+ * environment variable: "kind[,chunk_size]", for example "static", "dynamic,4" or "guided,16".
+ */
+
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <omp.h>
+
+// Parse "kind[,chunk_size]". Returns 0 on success and -1 if the text is not a valid schedule. A
+// missing chunk size is returned as 0, which omp_set_schedule() treats as "default chunk size".
+int schedule_parse(const char* text, omp_sched_t* kind, int* chunk_size);
+
+// Name of a schedule kind ("static", "dynamic", "guided", "auto").
+const char* schedule_kind_name(omp_sched_t kind);
+
+// Write "kind" or "kind,chunk_size" into buffer (at most size bytes including the terminator).
+void schedule_format(omp_sched_t kind, int chunk_size, char* buffer, unsigned long size);
+
+#endif
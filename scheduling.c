@@ -38,33 +38,250 @@
  * scheduling require runtime management of work distribution. The choice of scheduling type and
  * chunk size can impact the performance of a parallel loop, and it may require experimentation to
  * find the best configuration.
+ *
+ *
+ * Experimenting with Schedules:
+ *
+ * This program uses schedule(runtime), so we can try different schedules without recompiling. The
+ * schedule comes from the "--schedule" option, e.g. "--schedule dynamic,4" (this calls
+ * omp_set_schedule()), or else from the OMP_SCHEDULE environment variable, e.g.
+ * OMP_SCHEDULE="guided,8" ./scheduling 4 1000000. If neither is given, it uses static,2.
+ *
+ * The sum loop does the same tiny amount of work in every iteration, so it is perfectly balanced
+ * and static always wins. To see load imbalance, the "--workload" option adds extra work to each
+ * iteration with a chosen cost pattern (uniform, linear, heavy or spikes; see workload.h), and
+ * "--work" sets the average number of work units per iteration.
+ *
+ * The program prints how many iterations each thread ran and how long it was busy. The imbalance
+ * is the busiest thread's time divided by the average time: 1.00 means perfectly balanced, and the
+ * elapsed time of the loop is roughly the busiest thread's time. Try, for example:
+ *
+ *      ./scheduling 4 1000000 --workload linear --schedule static
+ *      ./scheduling 4 1000000 --workload linear --schedule dynamic,64
+ *      ./scheduling 4 1000000 --workload uniform --schedule dynamic,1
+ *
+ * The first shows imbalance, the second fixes it, and the third shows the overhead of handing out
+ * very small chunks when the work is already balanced.
+ *
+ * Instead of choosing by hand, "--autotune" lets the program experiment for us (see autotune.h).
+ * With "--repeat N" the loop runs N times; the first runs try different schedules, and the later
+ * runs use the fastest one. The winner is saved to a tuning cache, so the next run of the program
+ * with the same workload, similar upper_bound and the same number of threads starts tuned. The
+ * tuner picks the schedules itself, so "--autotune" cannot be combined with "--schedule":
+ *
+ *      ./scheduling 4 1000000 --workload heavy --autotune --repeat 30
  */
 
 #include <omp.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "autotune.h"
+#include "schedule.h"
+#include "workload.h"
+
+#define DEFAULT_WORK 100 // work units per iteration when only --workload is given
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s <num_threads> <upper_bound> [--schedule KIND[,CHUNK] | --autotune] "
+            "[--workload NAME] [--work UNITS] [--repeat N]\n",
+            program);
+    fprintf(stderr, "Workloads: uniform linear heavy spikes\n");
+}
+
+// Run the sum loop once with the current run-sched-var and return its elapsed time. Each thread
+// stores its busy time and number of iterations in busy_time[tid] and iterations[tid]. The result
+// of the extra work goes to *checksum; the caller prints it, so the work cannot be optimized away.
+static double run_loop(unsigned int thread_count, unsigned long upper_bound,
+                       workload_kind workload, unsigned long work, double* busy_time,
+                       unsigned long* iterations, unsigned long* sum, unsigned long* checksum) {
+    unsigned long global_sum = 0;
+    unsigned long work_sum = 0;
+
+    double start = omp_get_wtime();
+
+    // We use "parallel" + "for" instead of "parallel for" so that each thread can measure how long
+    // it was busy. "nowait" removes the barrier at the end of the loop, so a thread stops its timer
+    // as soon as it runs out of iterations instead of after waiting for the slowest thread.
+#pragma omp parallel num_threads(thread_count) reduction(+ : global_sum) reduction(^ : work_sum)
+    {
+        unsigned int tid = omp_get_thread_num();
+        unsigned long my_iterations = 0;
+        double thread_start = omp_get_wtime();
+
+#pragma omp for schedule(runtime) nowait
+        for (unsigned long i = 1; i <= upper_bound; i++) {
+            global_sum += i;
+            if (work > 0) {
+                work_sum ^= workload_spin(workload_cost(workload, i - 1, upper_bound, work), i);
+            }
+            my_iterations++;
+        }
+
+        busy_time[tid] = omp_get_wtime() - thread_start;
+        iterations[tid] = my_iterations;
+    }
+
+    *sum = global_sum;
+    *checksum = work_sum;
+    return omp_get_wtime() - start;
+}
 
 int main(int argc, char** argv) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <num_threads> <upper_bound>\n", argv[0]);
+    if (argc < 3) {
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
 
     unsigned int thread_count = atoi(argv[1]);
     unsigned long upper_bound = atol(argv[2]);
 
-    unsigned long global_sum = 0;
+    const char* schedule_text = NULL;
+    workload_kind workload = WORKLOAD_UNIFORM;
+    unsigned long work = 0;
+    int have_workload = 0, have_work = 0;
+    int autotune = 0;
+    unsigned int repeat = 1;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--autotune") == 0) {
+            autotune = 1;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(argv[i], "--schedule") == 0) {
+            schedule_text = argv[++i];
+        } else if (strcmp(argv[i], "--workload") == 0) {
+            if (workload_parse(argv[++i], &workload) != 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            have_workload = 1;
+        } else if (strcmp(argv[i], "--work") == 0) {
+            work = atol(argv[++i]);
+            have_work = 1;
+        } else if (strcmp(argv[i], "--repeat") == 0) {
+            repeat = atoi(argv[++i]);
+            if (repeat < 1) {
+                repeat = 1;
+            }
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (autotune && schedule_text != NULL) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (have_workload && !have_work) {
+        work = DEFAULT_WORK;
+    }
+
+    // schedule(runtime) takes the schedule from the run-sched-var. It is initialized from
+    // OMP_SCHEDULE and can be changed with omp_set_schedule().
+    omp_sched_t kind;
+    int chunk_size;
+    if (schedule_text != NULL) {
+        if (schedule_parse(schedule_text, &kind, &chunk_size) != 0) {
+            fprintf(stderr, "Invalid schedule: %s\n", schedule_text);
+            return EXIT_FAILURE;
+        }
+        omp_set_schedule(kind, chunk_size);
+    } else if (getenv("OMP_SCHEDULE") == NULL) {
+        omp_set_schedule(omp_sched_static, 2);
+    }
+
+    omp_get_schedule(&kind, &chunk_size);
+    char schedule_name[32];
+    schedule_format(kind, chunk_size, schedule_name, sizeof(schedule_name));
+    if (!autotune) {
+        printf("Schedule: %s\n", schedule_name);
+    }
+    printf("Workload: %s, %lu work units per iteration on average\n\n", workload_name(workload),
+           work);
+
+    double* busy_time = calloc(thread_count, sizeof(double));
+    unsigned long* iterations = calloc(thread_count, sizeof(unsigned long));
+    unsigned long global_sum = 0, checksum = 0;
+    double elapsed = 0.0;
+
+    if (!autotune) {
+        for (unsigned int r = 0; r < repeat; r++) {
+            elapsed = run_loop(thread_count, upper_bound, workload, work, busy_time, iterations,
+                               &global_sum, &checksum);
+        }
+    } else {
+        // The loop id names the loop body, so different workloads are tuned separately.
+        char loop_id[AUTOTUNE_ID_LENGTH];
+        snprintf(loop_id, sizeof(loop_id), "scheduling_%s_%lu", workload_name(workload), work);
+
+        autotune_loop tuner;
+        autotune_init(&tuner, loop_id, upper_bound, thread_count);
+        if (tuner.from_cache) {
+            printf("Autotune: using cached schedule\n");
+        }
+
+        for (unsigned int r = 0; r < repeat; r++) {
+            autotune_begin(&tuner);
+            autotune_candidate used = autotune_current(&tuner);
+            int was_tuned = tuner.tuned;
+
+            elapsed = run_loop(thread_count, upper_bound, workload, work, busy_time, iterations,
+                               &global_sum, &checksum);
+            autotune_end(&tuner, elapsed);
+
+            schedule_format(used.kind, used.chunk_size, schedule_name, sizeof(schedule_name));
+            printf("Run %u: %-13s %.6f s%s\n", r, schedule_name, elapsed,
+                   was_tuned ? " (tuned)" : "");
+        }
+
+        if (tuner.tuned) {
+            autotune_candidate best = autotune_current(&tuner);
+            schedule_format(best.kind, best.chunk_size, schedule_name, sizeof(schedule_name));
+            printf("Autotune: converged on %s\n\n", schedule_name);
+        } else {
+            printf("Autotune: still searching, it needs %u runs\n\n",
+                   tuner.num_candidates * AUTOTUNE_REPEATS);
+        }
+    }
+
+    double max_busy = 0.0, total_busy = 0.0;
+    for (unsigned int t = 0; t < thread_count; t++) {
+        printf("Thread %u: iterations = %lu, busy = %.6f s\n", t, iterations[t], busy_time[t]);
+        total_busy += busy_time[t];
+        if (busy_time[t] > max_busy) {
+            max_busy = busy_time[t];
+        }
+    }
 
-#pragma omp parallel for num_threads(thread_count) reduction(+ : global_sum) schedule(static, 2)
-    for (unsigned long i = 1; i <= upper_bound; i++) {
-        global_sum += i;
+    printf("\n");
+    printf("Elapsed time: %.6f s\n", elapsed);
+    if (work > 0) {
+        printf("Work checksum: %016lx\n", checksum);
     }
+    printf("Imbalance (max busy / average busy): %.2f\n",
+           total_busy > 0.0 ? max_busy / (total_busy / thread_count) : 1.0);
+    printf("\n");
 
-    // Expected sum from 1 to n is (n*(n+1))/2, so using this formula to verify our result.
-    unsigned long expected_sum = (upper_bound * (upper_bound + 1)) / 2;
+    // Expected sum from 1 to n is (n*(n+1))/2, so using this formula to verify our result. One of n
+    // and n+1 is even; halving it before the multiplication keeps n*(n+1) from overflowing.
+    unsigned long expected_sum = upper_bound % 2 == 0 ? (upper_bound / 2) * (upper_bound + 1)
+                                                       : upper_bound * ((upper_bound + 1) / 2);
     printf("Expected sum from 1 to %lu: %lu\n", upper_bound, expected_sum);
     printf("Sum we computed from 1 to %lu: %lu\n", upper_bound, global_sum);
     printf("Result is %s\n", (global_sum == expected_sum) ? "correct!!!" : "incorrect!");
 
+    free(busy_time);
+    free(iterations);
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -28,6 +28,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "range.h"
+
 int main(int argc, char** argv) {
     if (argc != 3) {
         fprintf(stderr, "Usage: %s <num_threads> <upper_bound>\n", argv[0]);
@@ -35,7 +37,7 @@ int main(int argc, char** argv) {
     }
 
     unsigned int thread_count = atoi(argv[1]);
-    unsigned long upper_bound = atol(argv[2]);
+    unsigned long upper_bound = strtoul(argv[2], NULL, 10);
 
     unsigned long global_sum = 0;
     unsigned long local_sum;
@@ -56,9 +58,12 @@ int main(int argc, char** argv) {
         // I am showing how to get it using OpenMP function for demonstration purpose.
         unsigned int num_threads = omp_get_num_threads();
 
-        // Calculate bounds for each thread
-        unsigned long local_start = (upper_bound * tid) / num_threads + 1;
-        unsigned long local_end = (upper_bound * (tid + 1)) / num_threads;
+        // Calculate bounds for each thread. The simple formula (upper_bound * tid) / num_threads
+        // overflows when upper_bound is large, so range_block() divides first (see range.h).
+        unsigned long block_start, block_end;
+        range_block(upper_bound, tid, num_threads, &block_start, &block_end);
+        unsigned long local_start = block_start + 1;
+        unsigned long local_end = block_end;
 
         printf("Thread %u: local_start = %lu, local_end = %lu\n", tid, local_start, local_end);
 
@@ -78,8 +83,10 @@ int main(int argc, char** argv) {
 
     printf("\n"); // Just to add a newline after the thread outputs
 
-    // Expected sum from 1 to n is (n*(n+1))/2, so using this formula to verify our result.
-    unsigned long expected_sum = (upper_bound * (upper_bound + 1)) / 2;
+    // Expected sum from 1 to n is (n*(n+1))/2, so using this formula to verify our result. One of n
+    // and n+1 is even; halving it before the multiplication keeps n*(n+1) from overflowing.
+    unsigned long expected_sum = upper_bound % 2 == 0 ? (upper_bound / 2) * (upper_bound + 1)
+                                                       : upper_bound * ((upper_bound + 1) / 2);
     printf("Expected sum from 1 to %lu: %lu\n", upper_bound, expected_sum);
     printf("Sum we computed from 1 to %lu: %lu\n", upper_bound, global_sum);
     printf("Result is %s\n", (global_sum == expected_sum) ? "correct!!!" : "incorrect!");
@@ -0,0 +1,60 @@
+/*
+ * Reading a saved series with mmap(). See series_file.h.
+ */
+
+#include "series_file.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int series_map(const char* path, series_view* view) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (unsigned long)info.st_size < sizeof(series_header)) {
+        fprintf(stderr, "%s: not a series file\n", path);
+        close(fd);
+        return -1;
+    }
+
+    // The mapping stays valid after the file descriptor is closed.
+    void* base = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+
+    const series_header* header = base;
+    int valid = memcmp(header->magic, SERIES_MAGIC, sizeof(header->magic)) == 0
+                && header->version == SERIES_VERSION && header->byte_order == SERIES_BYTE_ORDER
+                && header->element_size == sizeof(unsigned long)
+                && header->data_offset + header->count * header->element_size
+                       <= (unsigned long)info.st_size;
+    if (!valid) {
+        fprintf(stderr, "%s: not a complete series file\n", path);
+        munmap(base, info.st_size);
+        return -1;
+    }
+
+    view->header = header;
+    view->data = (const unsigned long*)((const char*)base + header->data_offset);
+    view->base = base;
+    view->length = info.st_size;
+    return 0;
+}
+
+void series_unmap(series_view* view) {
+    munmap(view->base, view->length);
+    view->base = NULL;
+    view->header = NULL;
+    view->data = NULL;
+}
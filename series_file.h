@@ -0,0 +1,57 @@
+/*
+ * On-disk format of a saved series (written by pipeline.c).
+ *
+ *      offset 0:                  series_header (fixed size)
+ *      offset header.data_offset: count elements of element_size bytes, in native byte order
+ *
+ * data_offset is a multiple of the page size (SERIES_DATA_OFFSET), so another process can mmap()
+ * the file and use the data as a plain array without copying it (see series_map()). The header
+ * also holds the statistics of the series, so a reader does not have to recompute them.
+ *
+ * The header is written last. A file whose header does not start with SERIES_MAGIC is incomplete
+ * (for example, the writer was interrupted) and is rejected by series_map().
+ */
+
+#ifndef SERIES_FILE_H
+#define SERIES_FILE_H
+
+#include <stdint.h>
+
+#define SERIES_MAGIC "TRISERIE" // 8 bytes, no terminator stored
+#define SERIES_VERSION 1
+#define SERIES_BYTE_ORDER 0x01020304u // reads back differently on a machine of the other endianness
+#define SERIES_DATA_OFFSET 4096
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t element_size;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t data_offset;
+
+    // Statistics of the series, see stats.h.
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t even_count;
+    double mean;
+    double variance;
+} series_header;
+
+// A series file mapped into memory.
+typedef struct {
+    const series_header* header;
+    const unsigned long* data; // header->count elements
+    void* base;
+    unsigned long length;
+} series_view;
+
+// Map a series file read-only. Returns 0 on success and -1 (with a message on stderr) if the file
+// cannot be opened or is not a complete series file.
+int series_map(const char* path, series_view* view);
+
+void series_unmap(series_view* view);
+
+#endif
@@ -0,0 +1,348 @@
+/*
+ * The sum of 1 through upper_bound with several processes instead of one OpenMP team.
+ *
+ * Some jobs have to run as several processes: one per socket, one per container, or one per node
+ * of a batch system. Each process runs its own OpenMP team, and the processes share their results
+ * through shared memory. This program compares that with the single process of reduction.c:
+ *
+ *      1. The coordinator creates a POSIX shared memory segment (shm_open(), ftruncate()) and
+ *         forks one worker per process.
+ *      2. Each worker opens the segment by name and maps it (mmap()), like an independent program
+ *         would, takes its slice of [1, upper_bound] (range_block() over the processes) and sums
+ *         it with an OpenMP team of its own (the reduction of reduction.c).
+ *      3. Each worker adds its partial sum to the total with atomic_fetch_add(): a single atomic
+ *         instruction on the shared page, so the combine needs no lock, and no worker waits for
+ *         another. It also stores its timings in its own slot of the segment.
+ *      4. The coordinator waits for the workers (wait()) and reads the total.
+ *
+ * For every number of processes the program prints the startup cost (from the fork to the moment
+ * the last worker's team starts summing), the compute time (the slowest worker's sum) and the
+ * total time (medians over the trials), and compares them with one process running a team of the
+ * same total number of threads. For that process the startup cost is the time until its first
+ * parallel region with that many threads starts, when the runtime creates the threads.
+ *
+ * NOTE: A child process created with fork() has only one thread. GCC's OpenMP runtime does not
+ * expect that if the parent has already run a parallel region, and the child's first parallel
+ * region can hang. So the coordinator runs all multi-process measurements before its own first
+ * parallel region.
+ *
+ * Atomics in shared memory work between processes only if they are lock-free (a lock-based atomic
+ * would use a lock that is private to each process); the program checks that.
+ *
+ * The total is one 64-bit atomic, so it would wrap around at 2^64 once upper_bound is above about
+ * 6 * 10^9. Such upper bounds are rejected, and the result is checked against the exact 128-bit
+ * sum (wide_sum_expected(), see wide_sum.h), so a wrapped total is never reported as correct.
+ *
+ * Compile:
+ *  make shm_sum
+ * Run:     ./shm_sum [--processes LIST] [--threads N] [--upper-bound N] [--trials N]
+ * Example: ./shm_sum --processes 1,2,4 --threads 8 --upper-bound 5000000000
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <omp.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "range.h"
+#include "wide_sum.h"
+
+#define MAX_PROCESSES 256
+
+// The shared memory segment. Every worker writes only its own slot.
+typedef struct {
+    atomic_ulong sum;  // the total, combined with atomic_fetch_add()
+    atomic_uint done;  // number of workers that have added their partial sum
+    struct {
+        double team_start; // when the worker's team started summing
+        double end;        // when it finished
+        unsigned long partial;
+    } workers[MAX_PROCESSES];
+} shm_segment;
+
+// Results of one configuration.
+typedef struct {
+    double startup;
+    double compute;
+    double total;
+    int correct;
+} sum_timing;
+
+// Seconds on a clock that is the same in every process (omp_get_wtime() need not be).
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// The reduction of reduction.c over [start + 1, end]. *team_start is set when the team starts.
+static unsigned long sum_slice(unsigned long start, unsigned long end, unsigned int thread_count,
+                               double* team_start) {
+    unsigned long sum = 0;
+
+#pragma omp parallel num_threads(thread_count) reduction(+ : sum)
+    {
+        unsigned int tid = omp_get_thread_num();
+        if (tid == 0) {
+            *team_start = now();
+        }
+
+        unsigned long local_start, local_end;
+        range_block(end - start, tid, omp_get_num_threads(), &local_start, &local_end);
+        for (unsigned long i = start + local_start + 1; i <= start + local_end; i++) {
+            sum += i;
+        }
+    }
+
+    return sum;
+}
+
+// A worker process: map the segment, sum slice "id" of "processes" and publish the result.
+static int run_worker(const char* name, unsigned int id, unsigned int processes,
+                      unsigned int thread_count, unsigned long upper_bound) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        perror("shm_open");
+        return EXIT_FAILURE;
+    }
+    shm_segment* segment =
+        mmap(NULL, sizeof(shm_segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    unsigned long start, end;
+    range_block(upper_bound, id, processes, &start, &end);
+    double team_start;
+    unsigned long partial = sum_slice(start, end, thread_count, &team_start);
+
+    segment->workers[id].team_start = team_start;
+    segment->workers[id].partial = partial;
+    segment->workers[id].end = now();
+    atomic_fetch_add_explicit(&segment->sum, partial, memory_order_relaxed);
+    // Release: a reader that sees the new count also sees the slot written above.
+    atomic_fetch_add_explicit(&segment->done, 1, memory_order_release);
+
+    munmap(segment, sizeof(shm_segment));
+    return EXIT_SUCCESS;
+}
+
+// One run with "processes" worker processes of thread_count threads each.
+static int run_processes(unsigned int processes, unsigned int thread_count,
+                         unsigned long upper_bound, sum_timing* timing) {
+    char name[64];
+    snprintf(name, sizeof(name), "/omp_tutorial_sum.%d", (int)getpid());
+
+    double start = now();
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        perror("shm_open");
+        return -1;
+    }
+    // A new segment is filled with zeros: sum = 0, done = 0.
+    if (ftruncate(fd, sizeof(shm_segment)) != 0) {
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    shm_segment* segment =
+        mmap(NULL, sizeof(shm_segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        perror("mmap");
+        shm_unlink(name);
+        return -1;
+    }
+
+    fflush(stdout); // or the children would print our buffered output again
+    int failed = 0;
+    unsigned int started = 0;
+    for (; started < processes; started++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(run_worker(name, started, processes, thread_count, upper_bound));
+        }
+        if (pid < 0) {
+            perror("fork");
+            failed = 1;
+            break;
+        }
+    }
+
+    for (unsigned int p = 0; p < started; p++) {
+        int status;
+        if (wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+            failed = 1;
+        }
+    }
+    double end = now();
+
+    // Acquire: pairs with the release of the workers, so their slots are visible.
+    failed = failed || atomic_load_explicit(&segment->done, memory_order_acquire) != processes;
+    timing->startup = 0.0;
+    timing->compute = 0.0;
+    for (unsigned int p = 0; p < processes && !failed; p++) {
+        double startup = segment->workers[p].team_start - start;
+        double compute = segment->workers[p].end - segment->workers[p].team_start;
+        timing->startup = startup > timing->startup ? startup : timing->startup;
+        timing->compute = compute > timing->compute ? compute : timing->compute;
+    }
+    timing->total = end - start;
+    timing->correct = !failed && atomic_load(&segment->sum) == wide_sum_expected(1, upper_bound);
+
+    munmap(segment, sizeof(shm_segment));
+    shm_unlink(name);
+    return failed ? -1 : 0;
+}
+
+// One run of a single process with a team of thread_count threads.
+static void run_single(unsigned int thread_count, unsigned long upper_bound, sum_timing* timing) {
+    double team_start;
+    double start = now();
+    unsigned long sum = sum_slice(0, upper_bound, thread_count, &team_start);
+    double end = now();
+
+    timing->startup = team_start - start;
+    timing->compute = end - team_start;
+    timing->total = end - start;
+    timing->correct = sum == wide_sum_expected(1, upper_bound);
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// The median of every field of the timings, and correct only if every run was correct.
+static void median_timing(sum_timing* runs, unsigned int trials, sum_timing* result) {
+    double* values = malloc(trials * sizeof(double));
+    double* fields[3] = { &result->startup, &result->compute, &result->total };
+    result->correct = 1;
+
+    for (int f = 0; f < 3; f++) {
+        for (unsigned int r = 0; r < trials; r++) {
+            double* run_fields[3] = { &runs[r].startup, &runs[r].compute, &runs[r].total };
+            values[r] = *run_fields[f];
+            result->correct = result->correct && runs[r].correct;
+        }
+        qsort(values, trials, sizeof(double), compare_doubles);
+        *fields[f] = values[trials / 2];
+    }
+
+    free(values);
+}
+
+static void print_row(const char* mode, unsigned int processes, unsigned int thread_count,
+                      unsigned long upper_bound, const sum_timing* timing,
+                      const sum_timing* single) {
+    printf("%s,%u,%u,%u,%lu,%.6f,%.6f,%.6f,%.3f,%s\n", mode, processes, thread_count,
+           processes * thread_count, upper_bound, timing->startup, timing->compute, timing->total,
+           single->total / timing->total, timing->correct ? "yes" : "no");
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--processes LIST] [--threads N] [--upper-bound N] [--trials N]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    unsigned long processes[BENCH_MAX_LIST] = { 1, 2, 4 };
+    int num_processes = 3;
+    unsigned int thread_count = 1;
+    unsigned long upper_bound = 500000000;
+    unsigned int trials = 5;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(argv[i], "--processes") == 0) {
+            num_processes = bench_parse_list(argv[++i], processes, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            thread_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--upper-bound") == 0) {
+            upper_bound = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--trials") == 0) {
+            trials = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (num_processes < 0 || thread_count < 1 || trials < 1) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (wide_sum_expected(1, upper_bound) > ULONG_MAX) {
+        fprintf(stderr, "The sum from 1 to %lu does not fit in 64 bits (at most about 6 * 10^9)\n",
+                upper_bound);
+        return EXIT_FAILURE;
+    }
+    for (int p = 0; p < num_processes; p++) {
+        if (processes[p] > MAX_PROCESSES) {
+            fprintf(stderr, "At most %d processes\n", MAX_PROCESSES);
+            return EXIT_FAILURE;
+        }
+    }
+
+    shm_segment probe;
+    if (!atomic_is_lock_free(&probe.sum) || !atomic_is_lock_free(&probe.done)) {
+        fprintf(stderr, "Atomics are not lock-free here, so they do not work between processes\n");
+        return EXIT_FAILURE;
+    }
+
+    sum_timing* runs = malloc(trials * sizeof(sum_timing));
+    sum_timing* multi = malloc(num_processes * sizeof(sum_timing));
+
+    // All multi-process runs first, before this process runs any parallel region (see the NOTE).
+    for (int p = 0; p < num_processes; p++) {
+        for (unsigned int r = 0; r < trials; r++) {
+            if (run_processes(processes[p], thread_count, upper_bound, &runs[r]) != 0) {
+                fprintf(stderr, "Run with %lu processes failed\n", processes[p]);
+                return EXIT_FAILURE;
+            }
+        }
+        median_timing(runs, trials, &multi[p]);
+    }
+
+    printf("mode,processes,threads_per_process,total_threads,upper_bound,startup_s,compute_s,"
+           "total_s,vs_single,correct\n");
+    int status = EXIT_SUCCESS;
+    for (int p = 0; p < num_processes; p++) {
+        unsigned int total_threads = processes[p] * thread_count;
+
+        for (unsigned int r = 0; r < trials; r++) {
+            run_single(total_threads, upper_bound, &runs[r]);
+        }
+        sum_timing single;
+        median_timing(runs, trials, &single);
+        // Only the first run creates (new) threads for the team, like every new process has to:
+        // its startup is the one to compare.
+        single.startup = runs[0].startup;
+
+        print_row("single", 1, total_threads, upper_bound, &single, &single);
+        print_row("multi", processes[p], thread_count, upper_bound, &multi[p], &single);
+        if (!single.correct || !multi[p].correct) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    free(multi);
+    free(runs);
+    return status;
+}
@@ -0,0 +1,134 @@
+/*
+ * Fused statistics kernel. See stats.h.
+ */
+
+#include "stats.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+void stats_init(stats* s) {
+    memset(s, 0, sizeof(*s));
+    s->min = ULONG_MAX;
+}
+
+// Merge (count_b, mean_b, m2_b) into *s (Chan et al.). Both counts may be 0.
+static void merge_moments(stats* s, unsigned long count_b, double mean_b, double m2_b) {
+    unsigned long count = s->count + count_b;
+    if (count == 0) {
+        return;
+    }
+
+    double delta = mean_b - s->mean;
+    s->mean += delta * ((double)count_b / count);
+    s->m2 += m2_b + delta * delta * ((double)s->count * count_b / count);
+    s->count = count;
+}
+
+void stats_combine(stats* out, const stats* in) {
+    out->sum += in->sum;
+    out->even_count += in->even_count;
+    out->min = in->min < out->min ? in->min : out->min;
+    out->max = in->max > out->max ? in->max : out->max;
+    for (int b = 0; b < STATS_BINS; b++) {
+        out->histogram[b] += in->histogram[b];
+    }
+    merge_moments(out, in->count, in->mean, in->m2);
+}
+
+void stats_add_block(stats* s, const unsigned long* values, unsigned long count) {
+    // Larger blocks are split so that the block sum below cannot overflow.
+    while (count > STATS_BLOCK) {
+        stats_add_block(s, values, STATS_BLOCK);
+        values += STATS_BLOCK;
+        count -= STATS_BLOCK;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    // The exact block sum can be larger than 2^64, which we need for the mean. Since a block has at
+    // most STATS_BLOCK = 2^10 values, summing (value >> 10) and (value & 1023) separately cannot
+    // overflow, and block sum = high_sum * 2^10 + low_sum. This avoids converting every value to
+    // double here: AVX2 has no instruction for 64-bit integer to double conversion, and the
+    // conversion would keep this whole loop from vectorizing.
+    unsigned long high_sum = 0;
+    unsigned long low_sum = 0;
+    unsigned long even_count = 0;
+    unsigned long min_val = ULONG_MAX;
+    unsigned long max_val = 0;
+
+    // Everything except the variance and the histogram in one vectorized loop. The loop body has
+    // no branches: min/max become vector min/max (or compare + blend) and the even test becomes a
+    // bit operation.
+#pragma omp simd reduction(+ : high_sum, low_sum, even_count) reduction(min : min_val)             \
+    reduction(max : max_val)
+    for (unsigned long i = 0; i < count; i++) {
+        unsigned long value = values[i];
+        high_sum += value >> 10;
+        low_sum += value & 1023;
+        even_count += ~value & 1;
+        min_val = value < min_val ? value : min_val;
+        max_val = value > max_val ? value : max_val;
+    }
+
+    // The block is still in cache, so these loops do not read the array from memory again. The
+    // variance loop converts to double, so it is vectorized with AVX-512 but not with AVX2.
+    double mean = ((double)high_sum * 1024.0 + (double)low_sum) / count;
+    double m2 = 0.0;
+#pragma omp simd reduction(+ : m2)
+    for (unsigned long i = 0; i < count; i++) {
+        double delta = (double)values[i] - mean;
+        m2 += delta * delta;
+    }
+
+    for (unsigned long i = 0; i < count; i++) {
+        unsigned long value = values[i];
+        s->histogram[value == 0 ? 0 : 64 - __builtin_clzl(value)]++;
+    }
+
+    s->sum += (high_sum << 10) + low_sum; // wraps around modulo 2^64
+    s->even_count += even_count;
+    s->min = min_val < s->min ? min_val : s->min;
+    s->max = max_val > s->max ? max_val : s->max;
+    merge_moments(s, count, mean, m2);
+}
+
+void stats_compute(const unsigned long* data, unsigned long n, unsigned int thread_count,
+                   stats* result) {
+    stats total;
+    stats_init(&total);
+
+    unsigned long num_blocks = (n + STATS_BLOCK - 1) / STATS_BLOCK;
+
+    // Each thread gets a private "total" initialized by stats_init(), adds its blocks to it, and the
+    // private copies are merged with stats_combine() at the end, like any other reduction.
+#pragma omp parallel for num_threads(thread_count) schedule(static) reduction(stats_merge : total)
+    for (unsigned long b = 0; b < num_blocks; b++) {
+        unsigned long start = b * STATS_BLOCK;
+        unsigned long end = start + STATS_BLOCK < n ? start + STATS_BLOCK : n;
+        stats_add_block(&total, data + start, end - start);
+    }
+
+    *result = total;
+}
+
+double stats_variance(const stats* s) {
+    return s->count > 0 ? s->m2 / s->count : 0.0;
+}
+
+void stats_print_histogram(const stats* s) {
+    for (int b = 0; b < STATS_BINS; b++) {
+        if (s->histogram[b] == 0) {
+            continue;
+        }
+        if (b == 0) {
+            printf("  [0, 1):  %lu\n", s->histogram[b]);
+        } else if (b == 64) {
+            printf("  [2^63, 2^64):  %lu\n", s->histogram[b]);
+        } else {
+            printf("  [%lu, %lu):  %lu\n", 1UL << (b - 1), 1UL << b, s->histogram[b]);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * Fused single-pass statistics over an array of unsigned long.
+ *
+ * bug_hunt_solution.c needs sum, min, max, even count and average of the array. With one reduction
+ * clause per statistic, each statistic is simple, but adding more (variance, a histogram) means
+ * more variables, more clauses and possibly more passes over the array. Instead we keep all of the
+ * statistics in one struct and tell OpenMP how to combine two of them with a user-defined
+ * reduction:
+ *
+ *      #pragma omp declare reduction(stats_merge : stats : stats_combine(&omp_out, &omp_in))     \
+ *          initializer(stats_init(&omp_priv))
+ *
+ * After that, reduction(stats_merge : total) works just like reduction(+ : sum): every thread gets
+ * a private stats initialized by stats_init(), and the private copies are merged with
+ * stats_combine() at the end of the loop.
+ *
+ * The array is processed in small blocks (STATS_BLOCK elements, a few KiB, so a block stays in
+ * the L1 cache). For each block, one "omp simd" loop computes sum, min, max, even count and the
+ * exact block sum for the mean, and then the block is re-read from cache to compute the squared
+ * deviations from the block mean and the histogram. The array itself is only read once from
+ * memory.
+ *
+ * Variance uses the parallel formula of Chan et al.: each block keeps its mean and the sum of
+ * squared deviations from it (m2), and two (count, mean, m2) triples are merged exactly. This
+ * avoids the cancellation of the textbook formula E[x^2] - E[x]^2 for large values.
+ *
+ * The histogram counts values by bit width: bin b holds values in [2^(b-1), 2^b), and bin 0 holds
+ * the value 0. This needs no knowledge of the range of the data before the pass.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#define STATS_BLOCK 1024 // must be at most 1024, see stats_add_block()
+#define STATS_BINS 65
+
+typedef struct {
+    unsigned long count;
+    unsigned long sum; // wraps around modulo 2^64, like the sum in bug_hunt_solution.c
+    unsigned long min;
+    unsigned long max;
+    unsigned long even_count;
+    double mean;
+    double m2; // sum of squared deviations from the mean
+    unsigned long histogram[STATS_BINS];
+} stats;
+
+// Set *s to the identity of the reduction (no values).
+void stats_init(stats* s);
+
+// Merge *in into *out.
+void stats_combine(stats* out, const stats* in);
+
+// reduction(stats_merge : s) for a variable "s" of type stats. See the top of this file.
+#pragma omp declare reduction(stats_merge : stats : stats_combine(&omp_out, &omp_in))              \
+    initializer(stats_init(&omp_priv))
+
+// Add values[0..count) to *s. Larger inputs are processed STATS_BLOCK values at a time.
+void stats_add_block(stats* s, const unsigned long* values, unsigned long count);
+
+// Compute the statistics of data[0..n) in parallel with a user-defined reduction.
+void stats_compute(const unsigned long* data, unsigned long n, unsigned int thread_count,
+                   stats* result);
+
+// Population variance (m2 / count).
+double stats_variance(const stats* s);
+
+// Print the non-empty histogram bins, one per line.
+void stats_print_histogram(const stats* s);
+
+#endif
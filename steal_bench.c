@@ -0,0 +1,254 @@
+/*
+ * Work stealing (work_steal.h) vs OpenMP static, dynamic and guided scheduling.
+ *
+ * schedule(dynamic) balances load with one shared counter from which every thread takes its next
+ * chunk. With small chunks and many threads that counter becomes a hotspot. The work-stealing
+ * executor has no shared counter: every worker splits ranges in its own deque and only touches
+ * another worker's deque when it runs out of work.
+ *
+ * Two kernels are run with each backend:
+ *
+ *      sum   -- the sum from 1 to size of the tutorial programs (sum_kernels.h)
+ *      stats -- the statistics of bug_hunt_solution.c (stats.h) over an array of "size"
+ *               triangular numbers
+ *
+ * and the grain is the unit of work handed out in both:
+ *
+ *      steal        -- ranges are split down to at most grain iterations
+ *      omp_static   -- schedule(static), one block per thread (grain is not used)
+ *      omp_dynamic  -- schedule(dynamic) with chunks of grain iterations
+ *      omp_guided   -- schedule(guided), chunks shrink down to grain iterations
+ *
+ * Every result is checked. The output is CSV with the throughput in millions of elements per
+ * second.
+ *
+ * Compile:
+ *  make steal_bench
+ * Run:     ./steal_bench [--threads LIST] [--sizes LIST] [--grains LIST] [--warmup N] [--trials N]
+ * Example: ./steal_bench --threads 1,2,4,8 --grains 64,1024,16384 > steal.csv
+ */
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "stats.h"
+#include "sum_kernels.h"
+#include "triangular.h"
+#include "work_steal.h"
+
+typedef enum {
+    BACKEND_STEAL,
+    BACKEND_OMP_STATIC,
+    BACKEND_OMP_DYNAMIC,
+    BACKEND_OMP_GUIDED,
+} backend_type;
+
+static const char* const backend_names[] = { "steal", "omp_static", "omp_dynamic", "omp_guided" };
+
+typedef struct {
+    backend_type backend;
+    int stats_kernel; // 0: sum, 1: stats
+    ws_executor* ex;
+    unsigned int threads;
+    unsigned long size;
+    unsigned long grain;
+    const unsigned long* data; // stats kernel input
+    unsigned long sum;
+    stats result;
+} steal_run;
+
+static void sum_body(unsigned long begin, unsigned long end, void* partial, void* arg) {
+    (void)arg;
+    unsigned long sum = 0;
+    for (unsigned long i = begin; i < end; i++) {
+        sum += i;
+    }
+    *(unsigned long*)partial += sum;
+}
+
+static void sum_combine(void* into, const void* from) {
+    *(unsigned long*)into += *(const unsigned long*)from;
+}
+
+static void stats_body(unsigned long begin, unsigned long end, void* partial, void* arg) {
+    const unsigned long* data = arg;
+    stats_add_block(partial, data + begin, end - begin);
+}
+
+static void stats_merge_ptr(void* into, const void* from) {
+    stats_combine(into, from);
+}
+
+static omp_sched_t backend_schedule(backend_type backend) {
+    switch (backend) {
+    case BACKEND_OMP_DYNAMIC:
+        return omp_sched_dynamic;
+    case BACKEND_OMP_GUIDED:
+        return omp_sched_guided;
+    default:
+        return omp_sched_static;
+    }
+}
+
+// stats_compute() with schedule(dynamic) or schedule(guided), over blocks of grain elements.
+static void stats_schedule(const unsigned long* data, unsigned long n, unsigned int thread_count,
+                           omp_sched_t kind, unsigned long grain, stats* result) {
+    stats total;
+    stats_init(&total);
+
+    unsigned long num_blocks = (n + grain - 1) / grain;
+    omp_set_schedule(kind, 1);
+
+#pragma omp parallel for num_threads(thread_count) schedule(runtime) reduction(stats_merge : total)
+    for (unsigned long b = 0; b < num_blocks; b++) {
+        unsigned long start = b * grain;
+        unsigned long end = start + grain < n ? start + grain : n;
+        stats_add_block(&total, data + start, end - start);
+    }
+
+    *result = total;
+}
+
+static void run_kernel(void* arg) {
+    steal_run* run = arg;
+
+    if (run->backend == BACKEND_STEAL) {
+        if (run->stats_kernel) {
+            stats_init(&run->result);
+            parallel_reduce(run->ex, (ws_range){ 0, run->size }, run->grain, stats_body,
+                            stats_merge_ptr, &run->result, sizeof(stats), (void*)run->data);
+        } else {
+            run->sum = 0;
+            parallel_reduce(run->ex, (ws_range){ 1, run->size + 1 }, run->grain, sum_body,
+                            sum_combine, &run->sum, sizeof(run->sum), NULL);
+        }
+        return;
+    }
+
+    omp_sched_t kind = backend_schedule(run->backend);
+    if (run->stats_kernel && kind == omp_sched_static) {
+        // One block per thread, like the sum: stats_compute() itself, which ignores the grain.
+        stats_compute(run->data, run->size, run->threads, &run->result);
+    } else if (run->stats_kernel) {
+        stats_schedule(run->data, run->size, run->threads, kind, run->grain, &run->result);
+    } else {
+        int chunk = kind == omp_sched_static ? 0 : (int)run->grain;
+        run->sum = sum_schedule(run->size, run->threads, kind, chunk);
+    }
+}
+
+// The statistics that do not depend on the order of the merges must match exactly.
+static int same_stats(const stats* a, const stats* b) {
+    return a->count == b->count && a->sum == b->sum && a->min == b->min && a->max == b->max &&
+           a->even_count == b->even_count &&
+           memcmp(a->histogram, b->histogram, sizeof(a->histogram)) == 0;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--threads LIST] [--sizes LIST] [--grains LIST] [--warmup N] "
+            "[--trials N]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads[BENCH_MAX_LIST];
+    unsigned long sizes[BENCH_MAX_LIST] = { 10000000 };
+    unsigned long grains[BENCH_MAX_LIST] = { 256, 4096, 65536 };
+    int num_threads = bench_default_threads(threads, BENCH_MAX_LIST);
+    int num_sizes = 1;
+    int num_grains = 3;
+    bench_config config = { .warmup = 1, .trials = 5 };
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(argv[i], "--threads") == 0) {
+            num_threads = bench_parse_list(argv[++i], threads, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--sizes") == 0) {
+            num_sizes = bench_parse_list(argv[++i], sizes, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--grains") == 0) {
+            num_grains = bench_parse_list(argv[++i], grains, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--warmup") == 0) {
+            config.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--trials") == 0) {
+            config.trials = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (num_threads < 0 || num_sizes < 0 || num_grains < 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("backend,kernel,threads,size,grain,min_s,median_s,p95_s,melems_per_s\n");
+
+    for (int s = 0; s < num_sizes; s++) {
+        unsigned long size = sizes[s];
+
+        // Input of the stats kernel and its reference result.
+        unsigned long* data = malloc(size * sizeof(unsigned long));
+        if (data == NULL) {
+            fprintf(stderr, "Cannot allocate %lu numbers\n", size);
+            return EXIT_FAILURE;
+        }
+#pragma omp parallel for
+        for (unsigned long i = 0; i < size; i++) {
+            data[i] = triangular(i);
+        }
+        stats expected;
+        stats_compute(data, size, omp_get_max_threads(), &expected);
+
+        for (int t = 0; t < num_threads; t++) {
+            ws_executor* ex = ws_executor_create(threads[t]);
+            if (ex == NULL) {
+                fprintf(stderr, "Cannot start %lu workers\n", threads[t]);
+                return EXIT_FAILURE;
+            }
+
+            for (int kernel = 0; kernel <= 1; kernel++) {
+                for (int g = 0; g < num_grains; g++) {
+                    for (int b = BACKEND_STEAL; b <= BACKEND_OMP_GUIDED; b++) {
+                        steal_run run = { .backend = b,
+                                          .stats_kernel = kernel,
+                                          .ex = ex,
+                                          .threads = threads[t],
+                                          .size = size,
+                                          .grain = grains[g],
+                                          .data = data };
+                        bench_result result;
+                        bench_measure(&config, run_kernel, &run, &result);
+
+                        if (kernel ? !same_stats(&run.result, &expected)
+                                   : run.sum != sum_expected(size)) {
+                            fprintf(stderr, "%s: incorrect result for %u threads, grain %lu\n",
+                                    backend_names[b], run.threads, run.grain);
+                            return EXIT_FAILURE;
+                        }
+
+                        printf("%s,%s,%u,%lu,%lu,%.9f,%.9f,%.9f,%.2f\n", backend_names[b],
+                               kernel ? "stats" : "sum", run.threads, size, run.grain,
+                               result.min, result.median, result.p95,
+                               size / result.median / 1e6);
+                        fflush(stdout);
+                    }
+                }
+            }
+
+            ws_executor_destroy(ex);
+        }
+
+        free(data);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,255 @@
+/*
+ * Batch mode: answer many range-sum queries with one team of threads.
+ *
+ * The tutorial programs read one "<num_threads> <upper_bound>" pair, start a team, compute one sum
+ * and exit. For a small upper_bound almost all of the time goes into starting the process and the
+ * threads. This program reads a stream of queries and keeps ONE parallel region open for all of
+ * them, so the team is created once and stays warm:
+ *
+ *      #pragma omp parallel
+ *      {
+ *          repeat:
+ *              single:                     print the previous batch, read the next one
+ *              for schedule(dynamic) nowait: small queries, one whole query per iteration
+ *              for reduction, per query:   large queries, split across the whole team
+ *      }
+ *
+ * Small queries are spread over the threads (each query is summed by one thread), because
+ * splitting a small sum costs more in synchronization than it saves. Queries with at least
+ * --split numbers are split across the team like in parallel_for.c. The results are printed in the
+ * order of the queries, one per line, and the throughput goes to stderr.
+ *
+ * Query format, one per line:
+ *
+ *      <upper_bound>     sum from 1 to upper_bound
+ *      <start> <end>     sum from start to end (inclusive)
+ *
+ * A line that is not a valid query gets "error" as its result. The sums wrap around at 2^64 like in
+ * the tutorial programs. Queries of more than MAX_LOOP_SIZE numbers (2^36, minutes of summing)
+ * are answered with the closed form (start + end) * count / 2 instead of a loop, so that a single
+ * huge query like "1 18446744073709551614" cannot stall the whole batch.
+ *
+ * Compile:
+ *  make sum_batch
+ * Run:     ./sum_batch <num_threads> [FILE] [--batch N] [--split N]
+ * Example: seq 1 100000 | ./sum_batch 4 > sums.txt
+ */
+
+#include <errno.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_BATCH 1024
+#define DEFAULT_SPLIT (1UL << 20)
+#define MAX_LOOP_SIZE (1UL << 36) // larger queries use the closed form
+
+typedef struct {
+    unsigned long start;
+    unsigned long end;
+    int valid;
+    int closed_form; // result computed when the query was read
+    unsigned long result;
+} query;
+
+// strtoul() for a non-negative number. strtoul() itself accepts "-2" and returns ULONG_MAX - 1,
+// which would be a query over nearly all of 2^64; a '-' is reported as *negative instead.
+static unsigned long parse_number(const char* text, char** end, int* negative) {
+    const char* digits = text + strspn(text, " \t");
+    *negative = *digits == '-';
+    return strtoul(text, end, 10);
+}
+
+// Parse "<upper_bound>" or "<start> <end>". Returns 0 if the line is not a valid query.
+static int parse_query(const char* line, query* q) {
+    char* end;
+    int negative;
+    errno = 0;
+    unsigned long first = parse_number(line, &end, &negative);
+    if (end == line || errno != 0 || negative) {
+        return 0;
+    }
+
+    const char* rest = end;
+    unsigned long second = parse_number(rest, &end, &negative);
+    if (negative) {
+        return 0;
+    }
+    if (end == rest) {
+        q->start = 1;
+        q->end = first;
+    } else {
+        if (errno != 0 || first > second) {
+            return 0;
+        }
+        q->start = first;
+        q->end = second;
+    }
+
+    while (*end == ' ' || *end == '\t' || *end == '\r' || *end == '\n') {
+        end++;
+    }
+    // ULONG_MAX as the end would make "i <= end" always true.
+    return *end == '\0' && q->end != (unsigned long)-1;
+}
+
+// Sum of start .. end modulo 2^64, like the loop would compute it. Of (start + end) and the count
+// end - start + 1 exactly one is even; it is halved before the multiplication so that the division
+// is exact even though the product wraps.
+static unsigned long closed_form_sum(unsigned long start, unsigned long end) {
+    unsigned long count = end - start + 1;
+    if (count % 2 == 0) {
+        return (count / 2) * (start + end);
+    }
+    // start and end have the same parity here; (start + end) / 2 without overflowing.
+    return count * (start / 2 + end / 2 + (start & 1));
+}
+
+// Read up to max_queries queries. Returns how many were read; fewer than max_queries means the end
+// of the input.
+static unsigned long read_batch(FILE* in, query* queries, unsigned long max_queries) {
+    char line[256];
+    unsigned long count = 0;
+
+    while (count < max_queries && fgets(line, sizeof(line), in) != NULL) {
+        query* q = &queries[count++];
+        q->valid = parse_query(line, q);
+        q->closed_form = q->valid && q->end - q->start >= MAX_LOOP_SIZE;
+        q->result = q->closed_form ? closed_form_sum(q->start, q->end) : 0;
+    }
+    return count;
+}
+
+static void print_batch(const query* queries, unsigned long count) {
+    for (unsigned long i = 0; i < count; i++) {
+        if (queries[i].valid) {
+            printf("%lu\n", queries[i].result);
+        } else {
+            printf("error\n");
+        }
+    }
+}
+
+static int is_large(const query* q, unsigned long split) {
+    return q->valid && !q->closed_form && q->end >= q->start && q->end - q->start >= split;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s <num_threads> [FILE] [--batch N] [--split N]\n", program);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    unsigned int thread_count = atoi(argv[1]);
+    unsigned long batch_size = DEFAULT_BATCH;
+    unsigned long split = DEFAULT_SPLIT;
+    FILE* in = stdin;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch_size = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--split") == 0 && i + 1 < argc) {
+            split = atol(argv[++i]);
+        } else if (argv[i][0] != '-' && in == stdin) {
+            in = fopen(argv[i], "r");
+            if (in == NULL) {
+                perror(argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (thread_count < 1 || batch_size < 1 || split < 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    query* queries = malloc(batch_size * sizeof(query));
+    if (queries == NULL) {
+        fprintf(stderr, "Cannot allocate %lu queries\n", batch_size);
+        return EXIT_FAILURE;
+    }
+
+    // Shared by the team: the current batch, and the sum of the large query being split.
+    unsigned long count = 0;
+    unsigned long total_queries = 0;
+    int done = 0; // set by the reading thread, read by all after the barrier of single
+    unsigned long large_sum = 0;
+
+    double start = omp_get_wtime();
+
+#pragma omp parallel num_threads(thread_count)
+    for (;;) {
+        // One thread prints the finished batch and reads the next one. The others wait at the
+        // implicit barrier at the end of single, so they all see the new batch (and "done").
+#pragma omp single
+        {
+            print_batch(queries, count);
+            count = read_batch(in, queries, batch_size);
+            total_queries += count;
+            done = count == 0;
+        }
+        if (done) {
+            break;
+        }
+
+        // Small queries: one query per iteration, handed out dynamically because their sizes
+        // differ. nowait: threads that run out of small queries go on to the large ones.
+#pragma omp for schedule(dynamic, 16) nowait
+        for (unsigned long q = 0; q < count; q++) {
+            if (!queries[q].valid || queries[q].closed_form || is_large(&queries[q], split)) {
+                continue;
+            }
+            unsigned long sum = 0;
+            for (unsigned long i = queries[q].start; i <= queries[q].end; i++) {
+                sum += i;
+            }
+            queries[q].result = sum;
+        }
+
+        // Large queries: every thread takes a part of each one. Every thread goes through the same
+        // queries in the same order, as worksharing constructs require.
+        for (unsigned long q = 0; q < count; q++) {
+            if (!is_large(&queries[q], split)) {
+                continue;
+            }
+
+#pragma omp for reduction(+ : large_sum)
+            for (unsigned long i = queries[q].start; i <= queries[q].end; i++) {
+                large_sum += i;
+            }
+
+            // The implicit barrier of the loop above makes large_sum complete here.
+#pragma omp single
+            {
+                queries[q].result = large_sum;
+                large_sum = 0;
+            }
+        }
+
+        // Every query of the batch must be done before it is printed (the small-query loop has
+        // no barrier of its own).
+#pragma omp barrier
+    }
+
+    double elapsed = omp_get_wtime() - start;
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    free(queries);
+
+    fprintf(stderr, "%lu queries in %.6f s: %.0f queries/s (%u threads, batch %lu)\n",
+            total_queries, elapsed, elapsed > 0 ? total_queries / elapsed : 0.0, thread_count,
+            batch_size);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+/*
+ * Sum kernels from the tutorial programs. See sum_kernels.h.
+ */
+
+#include "sum_kernels.h"
+
+#include "range.h"
+
+unsigned long sum_critical(unsigned long upper_bound, unsigned int thread_count) {
+    unsigned long global_sum = 0;
+
+#pragma omp parallel num_threads(thread_count) default(none) shared(global_sum, upper_bound)
+    {
+        unsigned int tid = omp_get_thread_num();
+        unsigned int num_threads = omp_get_num_threads();
+
+        unsigned long block_start, block_end;
+        range_block(upper_bound, tid, num_threads, &block_start, &block_end);
+        unsigned long local_start = block_start + 1;
+        unsigned long local_end = block_end;
+
+        unsigned long local_sum = 0;
+        for (unsigned long i = local_start; i <= local_end; i++) {
+            local_sum += i;
+        }
+
+#pragma omp critical
+        {
+            global_sum += local_sum;
+        }
+    }
+
+    return global_sum;
+}
+
+unsigned long sum_reduction(unsigned long upper_bound, unsigned int thread_count) {
+    unsigned long global_sum = 0;
+
+#pragma omp parallel num_threads(thread_count) reduction(+ : global_sum)
+    {
+        unsigned int tid = omp_get_thread_num();
+        unsigned int num_threads = omp_get_num_threads();
+
+        unsigned long block_start, block_end;
+        range_block(upper_bound, tid, num_threads, &block_start, &block_end);
+        unsigned long local_start = block_start + 1;
+        unsigned long local_end = block_end;
+
+        for (unsigned long i = local_start; i <= local_end; i++) {
+            global_sum += i;
+        }
+    }
+
+    return global_sum;
+}
+
+unsigned long sum_parallel_for(unsigned long upper_bound, unsigned int thread_count) {
+    unsigned long global_sum = 0;
+
+#pragma omp parallel for num_threads(thread_count) reduction(+ : global_sum)
+    for (unsigned long i = 1; i <= upper_bound; i++) {
+        global_sum += i;
+    }
+
+    return global_sum;
+}
+
+unsigned long sum_schedule(unsigned long upper_bound, unsigned int thread_count, omp_sched_t kind,
+                           int chunk_size) {
+    unsigned long global_sum = 0;
+
+    // schedule(runtime) reads the schedule from the run-sched-var, which omp_set_schedule() sets.
+    // A chunk size < 1 selects the default chunk size for the kind.
+    omp_set_schedule(kind, chunk_size);
+
+#pragma omp parallel for num_threads(thread_count) reduction(+ : global_sum) schedule(runtime)
+    for (unsigned long i = 1; i <= upper_bound; i++) {
+        global_sum += i;
+    }
+
+    return global_sum;
+}
+
+unsigned long sum_taskloop(unsigned long upper_bound, unsigned int thread_count,
+                           unsigned long grainsize, unsigned long num_tasks) {
+    unsigned long global_sum = 0;
+
+    // One thread creates the tasks; the whole team (waiting at the end of single) runs them. The
+    // grainsize and num_tasks clauses cannot be switched off, hence three versions of the loop.
+#pragma omp parallel num_threads(thread_count)
+#pragma omp single
+    {
+        if (grainsize > 0) {
+#pragma omp taskloop grainsize(grainsize) reduction(+ : global_sum)
+            for (unsigned long i = 1; i <= upper_bound; i++) {
+                global_sum += i;
+            }
+        } else if (num_tasks > 0) {
+#pragma omp taskloop num_tasks(num_tasks) reduction(+ : global_sum)
+            for (unsigned long i = 1; i <= upper_bound; i++) {
+                global_sum += i;
+            }
+        } else {
+#pragma omp taskloop reduction(+ : global_sum)
+            for (unsigned long i = 1; i <= upper_bound; i++) {
+                global_sum += i;
+            }
+        }
+    }
+
+    return global_sum;
+}
+
+// Sum of the numbers in [start, end).
+static unsigned long sum_range_tasks(unsigned long start, unsigned long end, unsigned long cutoff) {
+    if (end - start <= cutoff) {
+        unsigned long sum = 0;
+        for (unsigned long i = start; i < end; i++) {
+            sum += i;
+        }
+        return sum;
+    }
+
+    unsigned long middle = start + (end - start) / 2;
+    unsigned long left_sum = 0;
+    unsigned long right_sum;
+
+    // The left half becomes a task that adds into its own copy of left_sum (in_reduction); the
+    // copies are combined into left_sum when the taskgroup ends. The right half is done by this
+    // task itself, which saves creating a second task. It must not touch left_sum while the
+    // taskgroup runs, so it uses a separate variable.
+#pragma omp taskgroup task_reduction(+ : left_sum)
+    {
+#pragma omp task in_reduction(+ : left_sum)
+        left_sum += sum_range_tasks(start, middle, cutoff);
+
+        right_sum = sum_range_tasks(middle, end, cutoff);
+    }
+
+    return left_sum + right_sum;
+}
+
+unsigned long sum_tasks(unsigned long upper_bound, unsigned int thread_count,
+                        unsigned long cutoff) {
+    unsigned long global_sum = 0;
+
+    if (cutoff < 1) {
+        cutoff = 1;
+    }
+
+#pragma omp parallel num_threads(thread_count)
+#pragma omp single
+    global_sum = sum_range_tasks(1, upper_bound + 1, cutoff);
+
+    return global_sum;
+}
+
+unsigned long sum_expected(unsigned long upper_bound) {
+    // Halve the even factor first, so that the product does not overflow before the division.
+    return upper_bound % 2 == 0 ? (upper_bound / 2) * (upper_bound + 1)
+                                : upper_bound * ((upper_bound + 1) / 2);
+}
@@ -0,0 +1,48 @@
+/*
+ * The "sum of 1 through upper_bound" kernels from the tutorial programs, without the printing, so
+ * that they can be timed and compared against each other.
+ *
+ *      sum_critical      -- scope.c:        manual partition, per-thread sum, critical combine
+ *      sum_reduction     -- reduction.c:    manual partition, reduction clause
+ *      sum_parallel_for  -- parallel_for.c: parallel for with reduction
+ *      sum_schedule      -- scheduling.c:   parallel for with reduction and a chosen schedule
+ *
+ * and two versions with tasks instead of a worksharing loop:
+ *
+ *      sum_taskloop      -- one thread creates tasks with taskloop, with a reduction clause
+ *      sum_tasks         -- recursive split in half, one task per half, combined with
+ *                           task_reduction / in_reduction, serial below a cutoff
+ *
+ * Tasks cost more to create and schedule than loop chunks, but they also work for nested and
+ * irregular work where a loop does not fit. Comparing them with sum_parallel_for on a kernel where
+ * the loop is ideal shows how much work a task needs for its overhead not to matter.
+ */
+
+#ifndef SUM_KERNELS_H
+#define SUM_KERNELS_H
+
+#include <omp.h>
+
+unsigned long sum_critical(unsigned long upper_bound, unsigned int thread_count);
+
+unsigned long sum_reduction(unsigned long upper_bound, unsigned int thread_count);
+
+unsigned long sum_parallel_for(unsigned long upper_bound, unsigned int thread_count);
+
+// Uses schedule(runtime) after setting the run-sched-var to (kind, chunk_size) with
+// omp_set_schedule(). A chunk_size < 1 means "use the default chunk size for this kind".
+unsigned long sum_schedule(unsigned long upper_bound, unsigned int thread_count, omp_sched_t kind,
+                           int chunk_size);
+
+// taskloop with grainsize(grainsize) if grainsize > 0, else num_tasks(num_tasks) if num_tasks > 0,
+// else the implementation's default split.
+unsigned long sum_taskloop(unsigned long upper_bound, unsigned int thread_count,
+                           unsigned long grainsize, unsigned long num_tasks);
+
+// Recursive divide and conquer: ranges of at most cutoff numbers (at least 1) are summed serially.
+unsigned long sum_tasks(unsigned long upper_bound, unsigned int thread_count, unsigned long cutoff);
+
+// Expected sum from 1 to n is (n*(n+1))/2, wrapped around at 2^64 like the sums above.
+unsigned long sum_expected(unsigned long upper_bound);
+
+#endif
@@ -0,0 +1,336 @@
+/*
+ * Synchronization microbenchmark: the global sum of scope.c implemented with different ways of
+ * protecting the shared variable.
+ *
+ * scope.c combines the per-thread partial sums with "critical", and the README lists "atomic" and
+ * locks as alternatives. This program measures them all:
+ *
+ *      critical  -- #pragma omp critical
+ *      named     -- #pragma omp critical(name). Unnamed critical sections all share one lock, so
+ *                   unrelated critical sections block each other; a named one has its own lock.
+ *      atomic    -- #pragma omp atomic, usually a single atomic instruction
+ *      lock      -- omp_lock_t with omp_set_lock()/omp_unset_lock()
+ *      nest_lock -- omp_nest_lock_t, a lock the owning thread may set again (extra bookkeeping)
+ *      reduction -- reduction(+ : sum), private copies combined by OpenMP at the end
+ *      c11       -- C11 atomic_fetch_add() with relaxed memory order, no OpenMP involved
+ *
+ * Each variant runs in two modes:
+ *
+ *      once -- every thread sums its iterations privately and updates the shared sum once at the
+ *              end (like scope.c). Synchronization cost is paid once per thread.
+ *      hot  -- the shared sum is updated in every iteration. Synchronization cost is paid once per
+ *              iteration and all threads compete for the same variable.
+ *
+ * Contention is controlled with "--work": the number of work units (see workload.h) each iteration
+ * does before its update. Less work between updates means more threads update at the same time.
+ * The result is reported as ns per iteration (median time / iterations), so "hot" minus "once"
+ * is the cost of one synchronized update under that contention.
+ *
+ * Compile:
+ *  make sync_bench
+ * Run:     ./sync_bench [--threads LIST] [--work LIST] [--iterations N] [--warmup N] [--trials N]
+ * Example: ./sync_bench --threads 1,2,4,8 --work 0,64 > sync.csv
+ */
+
+#include <omp.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "workload.h"
+
+typedef struct {
+    unsigned int threads;
+    unsigned long iterations;
+    unsigned long work;
+    int hot; // 1: update the shared sum in every iteration, 0: once per thread
+    unsigned long result;
+} sync_run;
+
+// Simulated work between updates. Always returns 0, but the compiler cannot know that, so the work
+// is not optimized away (xorshift never reaches 0 from a non-zero seed).
+static inline unsigned long delay(unsigned long work, unsigned long i) {
+    return work > 0 && workload_spin(work, i) == 0;
+}
+
+static void sum_critical(void* arg) {
+    sync_run* run = arg;
+    unsigned long global_sum = 0;
+
+#pragma omp parallel num_threads(run->threads)
+    {
+        unsigned long local_sum = 0;
+
+#pragma omp for
+        for (unsigned long i = 1; i <= run->iterations; i++) {
+            unsigned long value = i + delay(run->work, i);
+            if (run->hot) {
+#pragma omp critical
+                global_sum += value;
+            } else {
+                local_sum += value;
+            }
+        }
+
+        if (!run->hot) {
+#pragma omp critical
+            global_sum += local_sum;
+        }
+    }
+
+    run->result = global_sum;
+}
+
+static void sum_named_critical(void* arg) {
+    sync_run* run = arg;
+    unsigned long global_sum = 0;
+
+#pragma omp parallel num_threads(run->threads)
+    {
+        unsigned long local_sum = 0;
+
+#pragma omp for
+        for (unsigned long i = 1; i <= run->iterations; i++) {
+            unsigned long value = i + delay(run->work, i);
+            if (run->hot) {
+#pragma omp critical(global_sum_update)
+                global_sum += value;
+            } else {
+                local_sum += value;
+            }
+        }
+
+        if (!run->hot) {
+#pragma omp critical(global_sum_update)
+            global_sum += local_sum;
+        }
+    }
+
+    run->result = global_sum;
+}
+
+static void sum_atomic(void* arg) {
+    sync_run* run = arg;
+    unsigned long global_sum = 0;
+
+#pragma omp parallel num_threads(run->threads)
+    {
+        unsigned long local_sum = 0;
+
+#pragma omp for
+        for (unsigned long i = 1; i <= run->iterations; i++) {
+            unsigned long value = i + delay(run->work, i);
+            if (run->hot) {
+#pragma omp atomic
+                global_sum += value;
+            } else {
+                local_sum += value;
+            }
+        }
+
+        if (!run->hot) {
+#pragma omp atomic
+            global_sum += local_sum;
+        }
+    }
+
+    run->result = global_sum;
+}
+
+static void sum_lock(void* arg) {
+    sync_run* run = arg;
+    unsigned long global_sum = 0;
+    omp_lock_t lock;
+    omp_init_lock(&lock);
+
+#pragma omp parallel num_threads(run->threads)
+    {
+        unsigned long local_sum = 0;
+
+#pragma omp for
+        for (unsigned long i = 1; i <= run->iterations; i++) {
+            unsigned long value = i + delay(run->work, i);
+            if (run->hot) {
+                omp_set_lock(&lock);
+                global_sum += value;
+                omp_unset_lock(&lock);
+            } else {
+                local_sum += value;
+            }
+        }
+
+        if (!run->hot) {
+            omp_set_lock(&lock);
+            global_sum += local_sum;
+            omp_unset_lock(&lock);
+        }
+    }
+
+    omp_destroy_lock(&lock);
+    run->result = global_sum;
+}
+
+static void sum_nest_lock(void* arg) {
+    sync_run* run = arg;
+    unsigned long global_sum = 0;
+    omp_nest_lock_t lock;
+    omp_init_nest_lock(&lock);
+
+#pragma omp parallel num_threads(run->threads)
+    {
+        unsigned long local_sum = 0;
+
+#pragma omp for
+        for (unsigned long i = 1; i <= run->iterations; i++) {
+            unsigned long value = i + delay(run->work, i);
+            if (run->hot) {
+                omp_set_nest_lock(&lock);
+                global_sum += value;
+                omp_unset_nest_lock(&lock);
+            } else {
+                local_sum += value;
+            }
+        }
+
+        if (!run->hot) {
+            omp_set_nest_lock(&lock);
+            global_sum += local_sum;
+            omp_unset_nest_lock(&lock);
+        }
+    }
+
+    omp_destroy_nest_lock(&lock);
+    run->result = global_sum;
+}
+
+static void sum_reduction(void* arg) {
+    sync_run* run = arg;
+    unsigned long global_sum = 0;
+
+    // With a reduction, "hot" and "once" are the same: the update in the loop goes to a private
+    // copy, and OpenMP combines the copies once per thread at the end.
+#pragma omp parallel for num_threads(run->threads) reduction(+ : global_sum)
+    for (unsigned long i = 1; i <= run->iterations; i++) {
+        global_sum += i + delay(run->work, i);
+    }
+
+    run->result = global_sum;
+}
+
+static void sum_c11(void* arg) {
+    sync_run* run = arg;
+    _Atomic unsigned long global_sum = 0;
+
+#pragma omp parallel num_threads(run->threads)
+    {
+        unsigned long local_sum = 0;
+
+#pragma omp for
+        for (unsigned long i = 1; i <= run->iterations; i++) {
+            unsigned long value = i + delay(run->work, i);
+            if (run->hot) {
+                // Relaxed order is enough: only the final value matters, and the implicit barrier
+                // at the end of the parallel region orders it before the read below.
+                atomic_fetch_add_explicit(&global_sum, value, memory_order_relaxed);
+            } else {
+                local_sum += value;
+            }
+        }
+
+        if (!run->hot) {
+            atomic_fetch_add_explicit(&global_sum, local_sum, memory_order_relaxed);
+        }
+    }
+
+    run->result = atomic_load(&global_sum);
+}
+
+static const struct {
+    const char* name;
+    bench_kernel kernel;
+} variants[] = {
+    { "critical", sum_critical }, { "named", sum_named_critical }, { "atomic", sum_atomic },
+    { "lock", sum_lock },         { "nest_lock", sum_nest_lock },  { "reduction", sum_reduction },
+    { "c11", sum_c11 },
+};
+
+static const unsigned int num_variants = sizeof(variants) / sizeof(variants[0]);
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--threads LIST] [--work LIST] [--iterations N] [--warmup N] "
+            "[--trials N]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads[BENCH_MAX_LIST];
+    unsigned long work[BENCH_MAX_LIST] = { 0, 16, 256 };
+    int num_threads = bench_default_threads(threads, BENCH_MAX_LIST);
+    int num_work = 3;
+    unsigned long iterations = 1000000;
+    bench_config config = { .warmup = 1, .trials = 5 };
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(argv[i], "--threads") == 0) {
+            num_threads = bench_parse_list(argv[++i], threads, BENCH_MAX_LIST, 1);
+        } else if (strcmp(argv[i], "--work") == 0) {
+            num_work = bench_parse_list(argv[++i], work, BENCH_MAX_LIST, 0);
+        } else if (strcmp(argv[i], "--iterations") == 0) {
+            iterations = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0) {
+            config.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--trials") == 0) {
+            config.trials = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (num_threads < 0 || num_work < 0 || iterations == 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Halve the even factor first, so that the product does not overflow before the division.
+    unsigned long expected_sum = iterations % 2 == 0 ? (iterations / 2) * (iterations + 1)
+                                                     : iterations * ((iterations + 1) / 2);
+
+    printf("variant,mode,threads,work,iterations,min_s,median_s,p95_s,ns_per_iteration\n");
+
+    for (unsigned int v = 0; v < num_variants; v++) {
+        for (int hot = 0; hot <= 1; hot++) {
+            for (int w = 0; w < num_work; w++) {
+                for (int t = 0; t < num_threads; t++) {
+                    sync_run run = { .threads = threads[t],
+                                     .iterations = iterations,
+                                     .work = work[w],
+                                     .hot = hot };
+                    bench_result result;
+                    bench_measure(&config, variants[v].kernel, &run, &result);
+
+                    if (run.result != expected_sum) {
+                        fprintf(stderr, "%s: incorrect result for %u threads\n", variants[v].name,
+                                run.threads);
+                        return EXIT_FAILURE;
+                    }
+
+                    printf("%s,%s,%u,%lu,%lu,%.9f,%.9f,%.9f,%.2f\n", variants[v].name,
+                           hot ? "hot" : "once", run.threads, run.work, iterations, result.min,
+                           result.median, result.p95, result.median * 1e9 / iterations);
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
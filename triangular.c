@@ -0,0 +1,45 @@
+/*
+ * Triangular-number series. See triangular.h.
+ */
+
+#include "triangular.h"
+
+#include <omp.h>
+
+#include "range.h"
+
+unsigned long triangular(unsigned long i) {
+    // One of (i + 1) and (i + 2) is even. Halving that one first gives the exact result (modulo
+    // 2^64) without the intermediate product overflowing earlier than the result itself.
+    unsigned long a = i + 1;
+    unsigned long b = i + 2;
+    return (a % 2 == 0) ? (a / 2) * b : a * (b / 2);
+}
+
+void triangular_stream_stats(unsigned long n, unsigned int thread_count, stats* result) {
+    stats total;
+    stats_init(&total);
+
+#pragma omp parallel num_threads(thread_count) reduction(stats_merge : total)
+    {
+        unsigned long start, end;
+        range_block(n, omp_get_thread_num(), omp_get_num_threads(), &start, &end);
+
+        // Small private buffer: this is the only memory the series ever occupies.
+        unsigned long buffer[STATS_BLOCK];
+        unsigned long value = triangular(start); // seed the block from the closed form
+
+        for (unsigned long block = start; block < end; block += STATS_BLOCK) {
+            unsigned long count = end - block < STATS_BLOCK ? end - block : STATS_BLOCK;
+
+            for (unsigned long k = 0; k < count; k++) {
+                buffer[k] = value;
+                value += block + k + 2; // T(i + 1) = T(i) + (i + 2)
+            }
+
+            stats_add_block(&total, buffer, count);
+        }
+    }
+
+    *result = total;
+}
@@ -0,0 +1,34 @@
+/*
+ * The triangular-number series of the bug hunt challenge: array[i] = 1 + 2 + ... + (i + 1).
+ *
+ * bug_hunt_solution.c stores the whole series in an array, so n is limited by memory, and a large
+ * part of the run time goes to writing the array and reading it back. We don't actually need the
+ * array to compute statistics: the closed form
+ *
+ *      T(i) = (i + 1) * (i + 2) / 2
+ *
+ * gives any element directly. In streaming mode, each thread takes one contiguous block of
+ * indices, computes the first element of its block with the closed form, and then produces the
+ * next elements with one addition each (T(i + 1) = T(i) + (i + 2)), exactly like the serial loop.
+ * The values go into a small per-thread buffer of STATS_BLOCK elements that is handed to the
+ * statistics kernel (stats.h) while it is still in the L1 cache. Memory use is constant, so n can
+ * go to billions.
+ *
+ * Like the array version, values wrap around modulo 2^64 once they no longer fit in an unsigned
+ * long (from about n = 6 * 10^9). Sum, min, max, even count and histogram are identical to the
+ * array version for any n; mean and variance can differ in the last digits because the blocks are
+ * combined in a different order.
+ */
+
+#ifndef TRIANGULAR_H
+#define TRIANGULAR_H
+
+#include "stats.h"
+
+// T(i) = (i + 1) * (i + 2) / 2, modulo 2^64.
+unsigned long triangular(unsigned long i);
+
+// Statistics of T(0), ..., T(n - 1) without storing the series.
+void triangular_stream_stats(unsigned long n, unsigned int thread_count, stats* result);
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Overflow-safe sums. See wide_sum.h.
+ */
+
+#include "wide_sum.h"
+
+#include <omp.h>
+
+#include "range.h"
+
+wide_uint wide_sum_range(unsigned long start, unsigned long end, unsigned int thread_count) {
+    if (end < start) {
+        return 0;
+    }
+
+    // The loops run over offsets from start, so that no bound is ever larger than end.
+    unsigned long count = end - start + 1;
+    wide_uint total = 0;
+
+#pragma omp parallel num_threads(thread_count) reduction(+ : total)
+    {
+        unsigned long first, last;
+        range_block(count, omp_get_thread_num(), omp_get_num_threads(), &first, &last);
+
+        for (unsigned long block = first; block < last; block += WIDE_BLOCK) {
+            unsigned long block_end = last - block > WIDE_BLOCK ? block + WIDE_BLOCK : last;
+            unsigned long low = 0;
+            unsigned long high = 0;
+
+#pragma omp simd reduction(+ : low, high)
+            for (unsigned long k = block; k < block_end; k++) {
+                unsigned long i = start + k;
+                low += i & 0xFFFFFFFFUL;
+                high += i >> 32;
+            }
+
+            total += ((wide_uint)high << 32) + low;
+        }
+    }
+
+    return total;
+}
+
+wide_uint wide_sum_expected(unsigned long start, unsigned long end) {
+    if (end < start) {
+        return 0;
+    }
+
+    // Halve the even factor first, so that the division is exact and the product stays small.
+    wide_uint a = (wide_uint)start + end;
+    wide_uint count = (wide_uint)(end - start) + 1;
+    if (a % 2 == 0) {
+        a /= 2;
+    } else {
+        count /= 2;
+    }
+    return a * count;
+}
+
+char* wide_format(wide_uint value, char* buffer) {
+    char digits[WIDE_DIGITS];
+    int length = 0;
+
+    do {
+        digits[length++] = '0' + (int)(value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    for (int i = 0; i < length; i++) {
+        buffer[i] = digits[length - 1 - i];
+    }
+    buffer[length] = '\0';
+    return buffer;
+}
@@ -0,0 +1,39 @@
+/*
+ * Sums that do not overflow: 128-bit results with loops that still use SIMD instructions.
+ *
+ * The tutorial programs keep the sum in an unsigned long (64 bits). The sum from 1 to n is about
+ * n^2 / 2, which no longer fits in 64 bits when n is larger than about 6 * 10^9, and then the sum
+ * silently wraps around. (The expected sum (n * (n + 1)) / 2 wraps too, and the
+ * thread bounds (n * tid) / num_threads overflow even sooner; see range.h.)
+ *
+ * An unsigned __int128 accumulator holds any such sum, but 128-bit additions are two dependent
+ * 64-bit instructions (add, add with carry) that the compiler does not vectorize. So the loop uses
+ * two 64-bit lanes instead, the low and the high 32 bits of every number:
+ *
+ *      low  += i & 0xFFFFFFFF       (< 2^32 per number)
+ *      high += i >> 32              (< 2^32 per number)
+ *
+ * Neither lane can overflow within a block of up to 2^32 numbers, and both are plain 64-bit
+ * additions, which vectorize like the original loop. At the end of every block the lanes are
+ * added to the 128-bit total as high * 2^32 + low.
+ */
+
+#ifndef WIDE_SUM_H
+#define WIDE_SUM_H
+
+typedef unsigned __int128 wide_uint;
+
+#define WIDE_BLOCK (1UL << 20) // numbers per block, at most 2^32 (see above)
+#define WIDE_DIGITS 40         // enough for any wide_uint in decimal, with the '\0'
+
+// Sum of the numbers from start to end (inclusive) on thread_count threads. The range must have at
+// most ULONG_MAX numbers (anything but start = 0, end = ULONG_MAX).
+wide_uint wide_sum_range(unsigned long start, unsigned long end, unsigned int thread_count);
+
+// The same sum with the closed formula (start + end) * count / 2. Exact for end < 2^63.
+wide_uint wide_sum_expected(unsigned long start, unsigned long end);
+
+// Format value in decimal into buffer (at least WIDE_DIGITS characters). Returns buffer.
+char* wide_format(wide_uint value, char* buffer);
+
+#endif
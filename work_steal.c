@@ -0,0 +1,269 @@
+/*
+ * Work-stealing executor. See work_steal.h.
+ */
+
+#include "work_steal.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Ranges are only split while descending, so a deque holds at most one range per halving: 64 is
+// enough for any 64-bit range. The capacity is a power of 2 so that indices wrap with a mask.
+#define DEQUE_CAPACITY 128
+#define CACHE_LINE 64
+
+// Chase-Lev deque with a fixed buffer. The owner pushes and pops at the bottom, thieves steal at
+// the top. A thief may read a slot while the owner overwrites it, but then its compare-and-swap
+// on top fails and the value is thrown away; the slots are atomics so that this is not a data race.
+typedef struct {
+    _Atomic long top;
+    char pad[CACHE_LINE - sizeof(long)]; // thieves write top, the owner writes bottom
+    _Atomic long bottom;
+    _Atomic unsigned long begin[DEQUE_CAPACITY];
+    _Atomic unsigned long end[DEQUE_CAPACITY];
+} ws_deque;
+
+typedef struct {
+    _Alignas(CACHE_LINE) ws_deque deque;
+    _Alignas(CACHE_LINE) unsigned char partial[WS_MAX_RESULT_SIZE];
+    unsigned int id;
+    unsigned long random; // xorshift state for choosing victims
+    pthread_t thread;
+    ws_executor* ex;
+} ws_worker;
+
+struct ws_executor {
+    unsigned int thread_count;
+    ws_worker* workers;
+
+    // Sleeping between jobs: a new job increments generation.
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    unsigned long generation;
+    int shutdown;
+
+    // The current job.
+    ws_body body;
+    void* arg;
+    unsigned long grain;
+    _Atomic unsigned long pending;  // ranges pushed but not finished yet
+    _Atomic unsigned int finished; // workers that have left the current job
+};
+
+static void deque_push(ws_deque* d, ws_range r) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    atomic_store_explicit(&d->begin[b & (DEQUE_CAPACITY - 1)], r.begin, memory_order_relaxed);
+    atomic_store_explicit(&d->end[b & (DEQUE_CAPACITY - 1)], r.end, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+}
+
+// Take the newest range. Returns 0 if the deque is empty.
+static int deque_pop(ws_deque* d, ws_range* r) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed); // was empty
+        return 0;
+    }
+
+    r->begin = atomic_load_explicit(&d->begin[b & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    r->end = atomic_load_explicit(&d->end[b & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (t < b) {
+        return 1; // more than one range left, no thief can get this one
+    }
+
+    // The last range: race the thieves for it.
+    int won = atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                      memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return won;
+}
+
+// Take the oldest range of someone else's deque. Returns 0 if it is empty or another thread won.
+static int deque_steal(ws_deque* d, ws_range* r) {
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+    if (t >= b) {
+        return 0;
+    }
+
+    r->begin = atomic_load_explicit(&d->begin[t & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    r->end = atomic_load_explicit(&d->end[t & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    return atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                   memory_order_relaxed);
+}
+
+static int steal_random(ws_executor* ex, ws_worker* self, ws_range* r) {
+    if (ex->thread_count < 2) {
+        return 0;
+    }
+
+    // xorshift64
+    self->random ^= self->random << 13;
+    self->random ^= self->random >> 7;
+    self->random ^= self->random << 17;
+
+    // Any worker except ourselves.
+    unsigned int victim = self->random % (ex->thread_count - 1);
+    if (victim >= self->id) {
+        victim++;
+    }
+    return deque_steal(&ex->workers[victim].deque, r);
+}
+
+// Split r down to the grain, pushing the right halves for others to steal, and run the rest.
+static void run_range(ws_executor* ex, ws_worker* self, ws_range r) {
+    while (r.end - r.begin > ex->grain) {
+        unsigned long middle = r.begin + (r.end - r.begin) / 2;
+        // Count the new range before it becomes visible, so pending cannot reach 0 early.
+        atomic_fetch_add_explicit(&ex->pending, 1, memory_order_relaxed);
+        deque_push(&self->deque, (ws_range){ middle, r.end });
+        r.end = middle;
+    }
+
+    ex->body(r.begin, r.end, self->partial, ex->arg);
+    atomic_fetch_sub_explicit(&ex->pending, 1, memory_order_release);
+}
+
+// Work on the current job until every range is done.
+static void work(ws_executor* ex, ws_worker* self) {
+    ws_range r;
+    while (atomic_load_explicit(&ex->pending, memory_order_acquire) > 0) {
+        if (deque_pop(&self->deque, &r) || steal_random(ex, self, &r)) {
+            run_range(ex, self, r);
+        } else {
+            // Nothing to do right now. Give the CPU to a worker that has work, in case there are
+            // more workers than cores.
+            sched_yield();
+        }
+    }
+}
+
+static void* worker_main(void* data) {
+    ws_worker* self = data;
+    ws_executor* ex = self->ex;
+    unsigned long seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&ex->mutex);
+        while (ex->generation == seen && !ex->shutdown) {
+            pthread_cond_wait(&ex->wake, &ex->mutex);
+        }
+        if (ex->shutdown) {
+            pthread_mutex_unlock(&ex->mutex);
+            return NULL;
+        }
+        seen = ex->generation;
+        pthread_mutex_unlock(&ex->mutex);
+
+        work(ex, self);
+        atomic_fetch_add_explicit(&ex->finished, 1, memory_order_release);
+    }
+}
+
+ws_executor* ws_executor_create(unsigned int thread_count) {
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+
+    ws_executor* ex = calloc(1, sizeof(ws_executor));
+    if (ex == NULL) {
+        return NULL;
+    }
+    ex->workers = aligned_alloc(CACHE_LINE, thread_count * sizeof(ws_worker));
+    if (ex->workers == NULL) {
+        free(ex);
+        return NULL;
+    }
+    memset(ex->workers, 0, thread_count * sizeof(ws_worker));
+
+    ex->thread_count = thread_count;
+    pthread_mutex_init(&ex->mutex, NULL);
+    pthread_cond_init(&ex->wake, NULL);
+
+    for (unsigned int w = 0; w < thread_count; w++) {
+        ex->workers[w].id = w;
+        ex->workers[w].random = 0x9E3779B97F4A7C15UL * (w + 1);
+        ex->workers[w].ex = ex;
+    }
+
+    // Worker 0 is the thread that calls parallel_reduce().
+    for (unsigned int w = 1; w < thread_count; w++) {
+        if (pthread_create(&ex->workers[w].thread, NULL, worker_main, &ex->workers[w]) != 0) {
+            ex->thread_count = w; // run with the workers we have
+            break;
+        }
+    }
+
+    return ex;
+}
+
+void ws_executor_destroy(ws_executor* ex) {
+    pthread_mutex_lock(&ex->mutex);
+    ex->shutdown = 1;
+    pthread_cond_broadcast(&ex->wake);
+    pthread_mutex_unlock(&ex->mutex);
+
+    for (unsigned int w = 1; w < ex->thread_count; w++) {
+        pthread_join(ex->workers[w].thread, NULL);
+    }
+
+    pthread_cond_destroy(&ex->wake);
+    pthread_mutex_destroy(&ex->mutex);
+    free(ex->workers);
+    free(ex);
+}
+
+unsigned int ws_executor_threads(const ws_executor* ex) {
+    return ex->thread_count;
+}
+
+int parallel_reduce(ws_executor* ex, ws_range range, unsigned long grain, ws_body body,
+                    ws_combine combine, void* result, size_t result_size, void* arg) {
+    if (result_size > WS_MAX_RESULT_SIZE) {
+        return -1;
+    }
+    if (range.end <= range.begin) {
+        return 0;
+    }
+
+    for (unsigned int w = 0; w < ex->thread_count; w++) {
+        memcpy(ex->workers[w].partial, result, result_size);
+    }
+
+    ex->body = body;
+    ex->arg = arg;
+    ex->grain = grain > 0 ? grain : 1;
+    atomic_store(&ex->finished, 0);
+    atomic_store(&ex->pending, 1);
+    deque_push(&ex->workers[0].deque, range);
+
+    // The mutex also publishes the job fields above to the workers.
+    pthread_mutex_lock(&ex->mutex);
+    ex->generation++;
+    pthread_cond_broadcast(&ex->wake);
+    pthread_mutex_unlock(&ex->mutex);
+
+    work(ex, &ex->workers[0]);
+
+    // Wait until every worker has left the job before reading the partial results (and before the
+    // next job reuses the deques).
+    while (atomic_load_explicit(&ex->finished, memory_order_acquire) < ex->thread_count - 1) {
+        sched_yield();
+    }
+
+    memcpy(result, ex->workers[0].partial, result_size);
+    for (unsigned int w = 1; w < ex->thread_count; w++) {
+        combine(result, ex->workers[w].partial);
+    }
+    return 0;
+}
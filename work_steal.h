@@ -0,0 +1,69 @@
+/*
+ * A work-stealing executor for range reductions, on plain pthreads (no OpenMP).
+ *
+ * schedule(dynamic) hands out chunks from one shared counter. Every chunk is an atomic update of
+ * the same cache line, so with small chunks and many cores the threads queue up on that counter.
+ * Work stealing avoids the shared counter:
+ *
+ *      - Every worker has its own deque (double-ended queue) of ranges.
+ *      - A worker takes a range from the bottom of its own deque. While the range is larger than
+ *        the grain, it splits it in half, pushes the right half, and continues with the left half.
+ *        Ranges of at most "grain" iterations are run with the body function.
+ *      - A worker whose deque is empty picks another worker at random and steals from the top of
+ *        that worker's deque. The top holds the oldest, and therefore largest, ranges.
+ *
+ * The owner and the thieves work on different ends of a deque, so they only need to synchronize
+ * when it is almost empty. The deque is the lock-free one of Chase and Lev ("Dynamic circular
+ * work-stealing deque", SPAA 2005), with the C11 memory orders of Le, Pop, Cohen and Zappa Nardelli
+ * ("Correct and efficient work-stealing for weak memory models", PPoPP 2013).
+ *
+ * Usage:
+ *
+ *      ws_executor* ex = ws_executor_create(thread_count);
+ *      unsigned long sum = 0; // the identity of the reduction
+ *      parallel_reduce(ex, (ws_range){ 1, n + 1 }, 4096, sum_body, sum_combine, &sum, sizeof(sum),
+ *                      NULL);
+ *      ws_executor_destroy(ex);
+ *
+ * Every worker has a private partial result, which starts as a copy of *result (so *result must be
+ * the identity on entry). body(begin, end, partial, arg) adds the iterations [begin, end) to a
+ * partial result, and combine(into, from) merges two partial results. At the end the partial
+ * results are combined into *result in worker order; which ranges ended up in which partial result
+ * depends on the stealing, so floating-point results may differ in the last digits between runs.
+ *
+ * The workers are created once and sleep between calls, like an OpenMP thread team. The thread
+ * calling parallel_reduce() is worker 0.
+ */
+
+#ifndef WORK_STEAL_H
+#define WORK_STEAL_H
+
+#include <stddef.h>
+
+// Iterations [begin, end).
+typedef struct {
+    unsigned long begin;
+    unsigned long end;
+} ws_range;
+
+typedef void (*ws_body)(unsigned long begin, unsigned long end, void* partial, void* arg);
+typedef void (*ws_combine)(void* into, const void* from);
+
+typedef struct ws_executor ws_executor;
+
+// Start an executor with thread_count workers (including the caller). Returns NULL on failure.
+ws_executor* ws_executor_create(unsigned int thread_count);
+
+void ws_executor_destroy(ws_executor* ex);
+
+unsigned int ws_executor_threads(const ws_executor* ex);
+
+// Reduce body over range, splitting it down to at most grain iterations (at least 1). *result
+// holds the identity on entry and the result on return. Returns 0, or -1 if result_size is too
+// large for the per-worker buffers (WS_MAX_RESULT_SIZE).
+int parallel_reduce(ws_executor* ex, ws_range range, unsigned long grain, ws_body body,
+                    ws_combine combine, void* result, size_t result_size, void* arg);
+
+#define WS_MAX_RESULT_SIZE 1024
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Synthetic workloads. See workload.h.
+ */
+
+#include "workload.h"
+
+#include <math.h>
+#include <string.h>
+
+#define HEAVY_ALPHA 1.5     // Pareto shape; smaller means a heavier tail
+#define HEAVY_MAX_FACTOR 1000.0
+#define SPIKE_PERIOD 256
+#define SPIKE_FACTOR 64
+
+static const char* names[] = { "uniform", "linear", "heavy", "spikes" };
+
+int workload_parse(const char* name, workload_kind* kind) {
+    for (unsigned int k = 0; k < sizeof(names) / sizeof(names[0]); k++) {
+        if (strcmp(names[k], name) == 0) {
+            *kind = (workload_kind)k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char* workload_name(workload_kind kind) {
+    return names[kind];
+}
+
+// SplitMix64 finalizer: turns i into a well-mixed 64-bit value, used as a repeatable random number.
+static unsigned long mix(unsigned long x) {
+    x += 0x9e3779b97f4a7c15UL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9UL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebUL;
+    return x ^ (x >> 31);
+}
+
+unsigned long workload_cost(workload_kind kind, unsigned long i, unsigned long n,
+                            unsigned long base) {
+    switch (kind) {
+    case WORKLOAD_LINEAR:
+        return (2 * base * (i + 1)) / n;
+    case WORKLOAD_HEAVY: {
+        // u is uniform in (0, 1]. A Pareto(alpha) sample with minimum x_min is x_min / u^(1/alpha)
+        // and its mean is x_min * alpha / (alpha - 1), so x_min = base / 3 gives a mean of "base".
+        double u = ((mix(i) >> 11) + 1) * (1.0 / 9007199254740992.0);
+        double factor = pow(u, -1.0 / HEAVY_ALPHA);
+        if (factor > HEAVY_MAX_FACTOR) {
+            factor = HEAVY_MAX_FACTOR;
+        }
+        return (unsigned long)(factor * base * (HEAVY_ALPHA - 1.0) / HEAVY_ALPHA);
+    }
+    case WORKLOAD_SPIKES:
+        return i % SPIKE_PERIOD == 0 ? base * SPIKE_FACTOR : base;
+    case WORKLOAD_UNIFORM:
+    default:
+        return base;
+    }
+}
+
+unsigned long workload_spin(unsigned long units, unsigned long seed) {
+    // xorshift64: each step depends on the previous one, so the steps cannot be skipped or
+    // vectorized away.
+    unsigned long x = seed | 1;
+    for (unsigned long u = 0; u < units; u++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+    return x;
+}
@@ -0,0 +1,42 @@
+/*
+ * Synthetic workloads with a selectable cost per loop iteration.
+ *
+ * The sum loop in the tutorial does the same tiny amount of work in every iteration, so every
+ * schedule balances it perfectly and the cheapest schedule (static) always wins. Real loops are
+ * often imbalanced. These workloads give iteration i of n a cost in "work units" (one unit is a
+ * few nanoseconds of integer arithmetic) so we can see when dynamic or guided scheduling pays off:
+ *
+ *      uniform -- every iteration costs "base" units.
+ *      linear  -- cost grows linearly from ~0 to 2 * base units, so later iterations are heavier.
+ *      heavy   -- random heavy-tailed (Pareto) cost: most iterations are cheap, a few are up to
+ *                 1000 times more expensive. The "random" values come from a hash of i, so every
+ *                 run and every schedule sees exactly the same costs.
+ *      spikes  -- every 256th iteration costs 64 times more than the others (periodic spikes).
+ *
+ * All workloads except spikes have an average cost of about "base" units per iteration.
+ */
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+typedef enum {
+    WORKLOAD_UNIFORM,
+    WORKLOAD_LINEAR,
+    WORKLOAD_HEAVY,
+    WORKLOAD_SPIKES,
+} workload_kind;
+
+// Parse a workload name. Returns 0 on success and -1 if the name is unknown.
+int workload_parse(const char* name, workload_kind* kind);
+
+const char* workload_name(workload_kind kind);
+
+// Cost in work units of iteration i (0 <= i < n).
+unsigned long workload_cost(workload_kind kind, unsigned long i, unsigned long n,
+                            unsigned long base);
+
+// Do "units" units of work. The return value depends on every unit, so the compiler cannot remove
+// the work as long as the caller uses the result (e.g. XOR it into a reduction variable).
+unsigned long workload_spin(unsigned long units, unsigned long seed);
+
+#endif